@@ -0,0 +1,425 @@
+#include "backend.h"
+#include "batch.h"
+#include "cli.h"
+#include "image.h"
+#include "netpbm.h"
+#include "threadpool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <numeric>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define CACHE_LINE 64
+#define BANDS_PER_WORKER 4
+
+int alignedBandRows(int height, int rowBytes, int bands) {
+    int unit = CACHE_LINE / std::gcd(rowBytes, CACHE_LINE);
+    int rows = (height + bands - 1) / bands;
+    return std::max(unit, (rows + unit - 1) / unit * unit);
+}
+
+void splitRows(int part, int parts, int height, int* startY, int* endY) {
+    if (part >= parts) {
+        *startY = *endY = height;
+        return;
+    }
+    *startY = (int)((long)height * part / parts);
+    *endY = (int)((long)height * (part + 1) / parts);
+}
+
+static int imageRowBytes(const Image* image) {
+    return image->getWidth() * image->getChannels() * image->getSampleSize();
+}
+
+// La etapa k lee de current y escribe en spare, y se intercambian. En los
+// procesos que no son raiz no hay imagenes: solo participan en filterAll.
+Image* Backend::filterChain(Image* image, const Filter* filters, int count) {
+    Image* current = image;
+    Image* spare = NULL;
+    if (image != NULL) {
+        spare = Image::create(image->getMagicNumber(), image->getMaxColor());
+        spare->allocate(image->getMagicNumber(), image->getWidth(), image->getHeight(), image->getMaxColor());
+    }
+    for (int k = 0; k < count; k++) {
+        filterAll(current, &filters[k], 1, &spare);
+        std::swap(current, spare);
+    }
+    if (spare != image) delete spare;
+    return current;
+}
+
+class SerialBackend : public Backend {
+public:
+    const char* getName() const override { return "serial"; }
+    int getWorkers() const override { return 1; }
+
+    void filterAll(Image* image, const Filter* filters, int count, Image* const* outputs) override {
+        image->applyFiltersToRegion(filters, count, outputs, 0, image->getHeight());
+    }
+
+    // un solo hilo en frente de onda, mientras las bandas siguen en cache
+    Image* filterChain(Image* image, const Filter* filters, int count) override {
+        image->applyFilterChain(filters, count, false);
+        return image;
+    }
+};
+
+struct BandJob {
+    Image* image;
+    Image* const* outputs;
+    const Filter* filters;
+    int count;
+    int bandRows;
+};
+
+// cada banda lee de image y escribe en outputs: no hace falta ningun lock
+static void filterBand(void* context, int band) {
+    BandJob* job = static_cast<BandJob*>(context);
+    TraceSpan span("filter band");
+    int startY = band * job->bandRows;
+    int endY = std::min(job->image->getHeight(), startY + job->bandRows);
+    job->image->applyFiltersToRegion(job->filters, job->count, job->outputs, startY, endY);
+}
+
+class PthreadBackend : public Backend {
+private:
+    ThreadPool pool;
+
+public:
+    explicit PthreadBackend(int threads) : pool(threads > 0 ? threads : ThreadPool::hardwareThreads()) {}
+
+    const char* getName() const override { return "pthreads"; }
+    int getWorkers() const override { return pool.getThreads(); }
+
+    void filterAll(Image* image, const Filter* filters, int count, Image* const* outputs) override {
+        int height = image->getHeight();
+        int bandRows = alignedBandRows(height, imageRowBytes(image), pool.getThreads() * BANDS_PER_WORKER);
+        BandJob job = {image, outputs, filters, count, bandRows};
+        pool.run((height + bandRows - 1) / bandRows, filterBand, &job);
+    }
+
+    // una etapa por hilo, encadenadas por bandas de filas
+    Image* filterChain(Image* image, const Filter* filters, int count) override {
+        image->applyFilterChain(filters, count, true);
+        return image;
+    }
+};
+
+#ifdef _OPENMP
+class OpenMPBackend : public Backend {
+private:
+    int threads;
+    // filas por bloque con schedule(runtime); 0 para bandas alineadas
+    int blockRows;
+
+public:
+    OpenMPBackend(int requested, int rows) : blockRows(rows) {
+        if (requested > 0) omp_set_num_threads(requested);
+        threads = omp_get_max_threads();
+    }
+
+    const char* getName() const override { return "openmp"; }
+    int getWorkers() const override { return threads; }
+
+    void filterAll(Image* image, const Filter* filters, int count, Image* const* outputs) override {
+        int height = image->getHeight();
+        if (blockRows > 0) {
+            int blocks = (height + blockRows - 1) / blockRows;
+            #pragma omp parallel for schedule(runtime)
+            for (int block = 0; block < blocks; block++) {
+                TraceSpan span("filter band");
+                int startY = block * blockRows;
+                image->applyFiltersToRegion(filters, count, outputs, startY, std::min(height, startY + blockRows));
+            }
+            return;
+        }
+        int bandRows = alignedBandRows(height, imageRowBytes(image), threads * BANDS_PER_WORKER);
+        int bands = (height + bandRows - 1) / bandRows;
+        #pragma omp parallel for schedule(dynamic)
+        for (int band = 0; band < bands; band++) {
+            TraceSpan span("filter band");
+            int startY = band * bandRows;
+            image->applyFiltersToRegion(filters, count, outputs, startY, std::min(height, startY + bandRows));
+        }
+    }
+};
+#endif
+
+#ifdef HAVE_MPI
+MPI_Datatype mpiRowType(int rowBytes) {
+    MPI_Datatype rowType;
+    MPI_Type_contiguous(std::max(rowBytes, 1), MPI_BYTE, &rowType);
+    MPI_Type_commit(&rowType);
+    return rowType;
+}
+
+void mpiScatterRows(Image* image, const int* counts, const int* displs, MPI_Datatype rowType, void* rows,
+                    MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Scatterv(rank == 0 ? image->getRawPixels() : NULL, counts, displs, rowType, rows, counts[rank], rowType, 0,
+                 comm);
+}
+
+void mpiGatherRows(const void* rows, Image* image, const int* counts, const int* displs, MPI_Datatype rowType,
+                   MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Gatherv(rows, counts[rank], rowType, rank == 0 ? image->getRawPixels() : NULL, counts, displs, rowType, 0,
+                comm);
+}
+
+// Cada rank recibe su banda de filas con el halo que piden los filtros,
+// filtra sus filas en local y el rank 0 recoge las salidas. Las cadenas
+// repiten el reparto en cada etapa (filterChain por defecto).
+class MpiBackend : public Backend {
+private:
+    int rank;
+    int size;
+    bool ownsMpi;
+
+public:
+    MpiBackend() {
+        int initialized;
+        MPI_Initialized(&initialized);
+        ownsMpi = !initialized;
+        if (ownsMpi) MPI_Init(NULL, NULL);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+    }
+
+    ~MpiBackend() override {
+        if (ownsMpi) MPI_Finalize();
+    }
+
+    const char* getName() const override { return "mpi"; }
+    int getWorkers() const override { return size; }
+    bool isRoot() const override { return rank == 0; }
+    int getRank() const override { return rank; }
+
+    void filterAll(Image* image, const Filter* filters, int count, Image* const* outputs) override {
+        // tipo y tamano de la imagen: solo el rank 0 la tiene
+        int header[4] = {0, 0, 0, 0};
+        if (rank == 0) {
+            header[0] = image->getMagicNumber()[1];
+            header[1] = image->getWidth();
+            header[2] = image->getHeight();
+            header[3] = image->getMaxColor();
+        }
+        MPI_Bcast(header, 4, MPI_INT, 0, MPI_COMM_WORLD);
+        char magic[3] = {'P', (char)header[0], '\0'};
+        int width = header[1], height = header[2], maxColor = header[3];
+        int rowBytes = width * netpbmChannels(magic) * netpbmSampleBytes(maxColor);
+
+        int radius = 0;
+        for (int i = 0; i < count; i++) radius = std::max(radius, filterRadius(filters[i]));
+
+        // filas propias [startY, endY) y, con el halo, [haloY, haloEnd)
+        std::vector<int> counts(size), displs(size), ownCounts(size), ownDispls(size);
+        for (int r = 0; r < size; r++) {
+            int startY, endY;
+            splitRows(r, size, height, &startY, &endY);
+            int haloY = startY < endY ? std::max(0, startY - radius) : startY;
+            int haloEnd = startY < endY ? std::min(height, endY + radius) : startY;
+            counts[r] = haloEnd - haloY;
+            displs[r] = haloY;
+            ownCounts[r] = endY - startY;
+            ownDispls[r] = startY;
+        }
+
+        MPI_Datatype rowType = mpiRowType(rowBytes);
+        int localRows = counts[rank];
+        Image* local = Image::create(magic, maxColor);
+        local->allocate(magic, width, localRows, maxColor);
+        {
+            TraceSpan span("scatter");
+            mpiScatterRows(image, counts.data(), displs.data(), rowType, local->getRawPixels(), MPI_COMM_WORLD);
+        }
+
+        std::vector<Image*> localOutputs(count);
+        for (int i = 0; i < count; i++) {
+            localOutputs[i] = Image::create(magic, maxColor);
+            localOutputs[i]->allocate(magic, width, localRows, maxColor);
+        }
+        // fuera de la banda el motor rellena con ceros; solo ocurre en los
+        // bordes de la imagen, donde la banda no tiene halo
+        int first = ownDispls[rank] - displs[rank];
+        {
+            TraceSpan span("filter band");
+            local->applyFiltersToRegion(filters, count, localOutputs.data(), first, first + ownCounts[rank]);
+        }
+
+        for (int i = 0; i < count; i++) {
+            TraceSpan span("gather");
+            char* own = static_cast<char*>(localOutputs[i]->getRawPixels()) + (size_t)first * rowBytes;
+            mpiGatherRows(own, rank == 0 ? outputs[i] : NULL, ownCounts.data(), ownDispls.data(), rowType,
+                          MPI_COMM_WORLD);
+            delete localOutputs[i];
+        }
+        delete local;
+        MPI_Type_free(&rowType);
+    }
+
+    // el rank 0 decide si se sigue (p.ej. si pudo leer la entrada)
+    bool agree(bool ok) override {
+        int value = ok ? 1 : 0;
+        MPI_Bcast(&value, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        return value != 0;
+    }
+};
+#endif
+
+Backend* createBackend(const char* name, int threads) {
+    if (strcmp(name, "serial") == 0) return new SerialBackend();
+    if (strcmp(name, "pthreads") == 0) return new PthreadBackend(threads);
+#ifdef _OPENMP
+    if (strcmp(name, "openmp") == 0) return new OpenMPBackend(threads, 0);
+#endif
+#ifdef HAVE_MPI
+    if (strcmp(name, "mpi") == 0) return new MpiBackend();
+#endif
+    return NULL;
+}
+
+#ifdef _OPENMP
+Backend* createOpenMPBackend(int threads, int blockRows) {
+    return new OpenMPBackend(threads, blockRows);
+}
+#endif
+
+const char* availableBackends() {
+    return "serial, pthreads"
+#ifdef _OPENMP
+           ", openmp"
+#endif
+#ifdef HAVE_MPI
+           ", mpi"
+#endif
+        ;
+}
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void backendBatchItem(BatchItem* item, void* context) {
+    Backend* backend = static_cast<Backend*>(context);
+    const BatchEntry& entry = *item->entry;
+    if (entry.outputs.size() == 1 && entry.filterCount > 1) {
+        item->results[0] = backend->filterChain(item->image, entry.filters, entry.filterCount);
+        return;
+    }
+    allocateBatchResults(item);
+    backend->filterAll(item->image, entry.filters, entry.filterCount, item->results);
+}
+
+int backendMain(int argc, char* argv[], Backend* backend, const char* defaultFilters) {
+    // con una salida por filtro, cada filtro se aplica a la entrada por separado
+    int outputCount = countOutputPaths(argc, argv);
+    char** outputPaths = argv + 2;
+
+    const char* filterList = defaultFilters;
+    const char* kernelFile = NULL;
+    const char* backendName = NULL;
+    const char* tracePath = NULL;
+    int threads = 0;
+    for (int i = 2 + outputCount; i < argc; i++) {
+        if (strcmp(argv[i], "--f") == 0 && i + 1 < argc) filterList = argv[++i];
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) kernelFile = argv[++i];
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) backendName = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+    }
+    if (outputCount == 0 || (backend == NULL && backendName == NULL)) {
+        std::cout << "Usage:" << argv[0] << " input output [output...] --f filter1[,filter2...] | --kernel file.k"
+                  << " --backend " << availableBackends() << " [--threads N] [--trace trace.json]" << std::endl;
+        return 1;
+    }
+
+    Filter filters[MAX_FILTER_CHAIN];
+    int filterCount = parseFilterOptions(filterList, kernelFile, filters);
+    if (filterCount < 0) return 1;
+    if (outputCount > 1 && outputCount != filterCount) {
+        std::cout << "Error, give one output path or one per filter" << std::endl;
+        return 1;
+    }
+
+    Backend* created = NULL;
+    if (backend == NULL) {
+        created = backend = createBackend(backendName, threads);
+        if (backend == NULL) {
+            std::cout << "Error, backend " << backendName << " is not available. Use one of: " << availableBackends()
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    // con mpi cada rank guarda su traza; solo el rank 0 imprime el resumen
+    bool root = backend->isRoot();
+    bool tracing = tracePath != NULL;
+    if (tracing) traceStart(backend->getRank());
+
+    auto wallStart = std::chrono::steady_clock::now();
+    Image* image = root ? loadImageFile(argv[1]) : NULL;
+    if (!backend->agree(!root || image != NULL)) {
+        if (tracing) traceClear();
+        delete created;
+        return 1;
+    }
+    double parseThroughput = image != NULL ? image->getParseThroughput() : 0.0;
+
+    // una salida con varios filtros es una cadena; si no, un filtro por salida
+    Image* results[MAX_FILTER_CHAIN] = {NULL};
+    clock_t cpuStart = clock();
+    auto filterStart = std::chrono::steady_clock::now();
+    if (outputCount == 1 && filterCount > 1) {
+        results[0] = backend->filterChain(image, filters, filterCount);
+    } else {
+        for (int i = 0; root && i < outputCount; i++) {
+            results[i] = Image::create(image->getMagicNumber(), image->getMaxColor());
+            results[i]->allocate(image->getMagicNumber(), image->getWidth(), image->getHeight(),
+                                 image->getMaxColor());
+        }
+        backend->filterAll(image, filters, outputCount, results);
+    }
+    double filterSeconds = elapsedSeconds(filterStart);
+    double cpuSeconds = double(clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    bool saved = true;
+    for (int i = 0; root && i < outputCount; i++) {
+        if (!saveImageFile(results[i], outputPaths[i])) saved = false;
+    }
+    double wallSeconds = elapsedSeconds(wallStart);
+
+    if (root) {
+        std::cout << "Backend: " << backend->getName() << " (" << backend->getWorkers() << " workers)" << std::endl;
+        std::cout << "Filter Time: " << filterSeconds << " seconds" << std::endl;
+        printRunTimes(cpuSeconds, wallSeconds, parseThroughput);
+    }
+    if (tracing) {
+        traceStop();
+        if (!traceWriteChrome(tracePath)) {
+            std::cout << "Error, could not write the trace " << tracePath << std::endl;
+            saved = false;
+        } else if (root) {
+            std::cout.flush();
+            tracePrintSummary(stdout);
+        }
+        traceClear();
+    }
+
+    for (int i = 0; i < outputCount; i++) {
+        if (results[i] != image) delete results[i];
+    }
+    delete image;
+    delete created;
+    return saved ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "filters.h"
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+class Image;
+struct BatchItem;
+
+// Estrategia de ejecucion del filtrado. Todas usan el mismo motor
+// (applyFiltersToRegion / applyFilterChain) y solo cambian como se reparten
+// las filas: en serie, en un pool de pthreads, con OpenMP o entre procesos MPI.
+// Asi se pueden comparar en igualdad de condiciones y el resultado es el mismo.
+class Backend {
+public:
+    virtual ~Backend() = default;
+
+    virtual const char* getName() const = 0;
+    // hilos o procesos que reparten el trabajo
+    virtual int getWorkers() const = 0;
+    // solo el proceso raiz carga, guarda e imprime; el resto recibe image NULL
+    virtual bool isRoot() const { return true; }
+    // numero del proceso que llama (el rank con MPI), para la traza
+    virtual int getRank() const { return 0; }
+    // con varios procesos, todos siguen el valor de ok del raiz
+    virtual bool agree(bool ok) { return ok; }
+
+    // cada filtro a la imagen completa, en su outputs[i] (ya reservada)
+    virtual void filterAll(Image* image, const Filter* filters, int count, Image* const* outputs) = 0;
+    // Los filtros encadenados; devuelve la imagen con el resultado, que puede
+    // ser la propia image. Por defecto etapa a etapa con filterAll.
+    virtual Image* filterChain(Image* image, const Filter* filters, int count);
+};
+
+// "serial", "pthreads", "openmp" o "mpi"; NULL si no existe o no se compilo.
+// threads <= 0 usa los nucleos disponibles.
+Backend* createBackend(const char* name, int threads);
+#ifdef _OPENMP
+// El backend openmp con bloques de blockRows filas repartidos segun
+// omp_set_schedule (schedule(runtime)), para --schedule y --chunk de
+// omp_filterer. createBackend usa bandas alineadas y schedule(dynamic).
+Backend* createOpenMPBackend(int threads, int blockRows);
+#endif
+// los backends compilados, separados por comas
+const char* availableBackends();
+
+// Filas por banda para repartir height filas en bands bandas, redondeadas
+// para que dos bandas nunca escriban en la misma linea de cache.
+int alignedBandRows(int height, int rowBytes, int bands);
+// Filas [startY, endY) de la parte part de parts en que se divide height;
+// vacia (startY == endY == height) si part >= parts.
+void splitRows(int part, int parts, int height, int* startY, int* endY);
+
+#ifdef HAVE_MPI
+// Reparto de filas de MpiBackend, que tambien usa mpi_filterer.
+// Tipo MPI de una fila de rowBytes bytes, ya confirmado.
+MPI_Datatype mpiRowType(int rowBytes);
+// El rank 0 de comm reparte las filas de image (solo se usa en el rank 0):
+// el rank r recibe en rows counts[r] filas desde la fila displs[r].
+void mpiScatterRows(Image* image, const int* counts, const int* displs, MPI_Datatype rowType, void* rows,
+                    MPI_Comm comm);
+// Al reves: el rank 0 recoge en image las counts[r] filas de cada rank.
+void mpiGatherRows(const void* rows, Image* image, const int* counts, const int* displs, MPI_Datatype rowType,
+                   MPI_Comm comm);
+#endif
+
+// Calculo del modo --batch con el backend de context: una cadena si la
+// imagen tiene una salida y varios filtros, o cada filtro a su salida.
+void backendBatchItem(BatchItem* item, void* context);
+
+// Programa comun a los ejecutables:
+//   entrada salida [salida...] --f filtros | --kernel k.k [--trace traza.json]
+// con --backend nombre [--threads N] si backend es NULL. Carga, mide, filtra
+// y guarda igual con cualquier backend; sin --f usa defaultFilters. El
+// backend sigue siendo del que llama. Devuelve el codigo de salida.
+int backendMain(int argc, char* argv[], Backend* backend, const char* defaultFilters);
+
+#endif
@@ -0,0 +1,258 @@
+#include "batch.h"
+#include "image.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define DEFAULT_BATCH_DEPTH 2
+
+static double monotonicSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+BatchQueue::BatchQueue(int queueCapacity) : capacity(std::max(1, queueCapacity)) {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&notFull, nullptr);
+    pthread_cond_init(&notEmpty, nullptr);
+}
+
+BatchQueue::~BatchQueue() {
+    pthread_cond_destroy(&notEmpty);
+    pthread_cond_destroy(&notFull);
+    pthread_mutex_destroy(&mutex);
+}
+
+void BatchQueue::push(BatchItem* item) {
+    pthread_mutex_lock(&mutex);
+    while ((int)items.size() >= capacity) pthread_cond_wait(&notFull, &mutex);
+    items.push_back(item);
+    pthread_cond_signal(&notEmpty);
+    pthread_mutex_unlock(&mutex);
+}
+
+BatchItem* BatchQueue::pop() {
+    pthread_mutex_lock(&mutex);
+    while (items.empty()) pthread_cond_wait(&notEmpty, &mutex);
+    BatchItem* item = items.front();
+    items.pop_front();
+    pthread_cond_signal(&notFull);
+    pthread_mutex_unlock(&mutex);
+    return item;
+}
+
+static bool hasImageExtension(const std::string& name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = name.substr(dot);
+    return extension == ".pgm" || extension == ".ppm";
+}
+
+bool loadBatchManifest(const char* path, std::vector<BatchEntry>* entries) {
+    FILE* manifest = fopen(path, "r");
+    if (manifest == NULL) {
+        std::cout << "Error, could not open the manifest " << path << std::endl;
+        return false;
+    }
+
+    char line[4096];
+    int number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), manifest)) {
+        number++;
+        std::istringstream fields(line);
+        std::string input, filterList, output;
+        if (!(fields >> input) || input[0] == '#') continue;
+
+        BatchEntry entry;
+        entry.input = input;
+        fields >> filterList;
+        while (fields >> output) entry.outputs.push_back(output);
+        entry.filterCount = filterList.empty() ? -1 : parseFilterChain(filterList.c_str(), entry.filters, MAX_FILTER_CHAIN);
+
+        int outputs = (int)entry.outputs.size();
+        if (entry.filterCount < 0 || outputs == 0 || (outputs > 1 && outputs != entry.filterCount)) {
+            std::cout << "Error, " << path << ":" << number << ": expected input filter[,filter...] output [output...]" << std::endl;
+            ok = false;
+        } else {
+            entries->push_back(entry);
+        }
+    }
+    fclose(manifest);
+    return ok;
+}
+
+bool listBatchDirectory(const char* directory, const char* filterList, const char* outputDirectory,
+                        std::vector<BatchEntry>* entries) {
+    BatchEntry entry;
+    entry.filterCount = parseFilterChain(filterList, entry.filters, MAX_FILTER_CHAIN);
+    if (entry.filterCount < 0) {
+        std::cout << "Error, wrong filter list " << filterList << std::endl;
+        return false;
+    }
+    if (mkdir(outputDirectory, 0755) != 0 && errno != EEXIST) {
+        std::cout << "Error, could not create the output directory " << outputDirectory << std::endl;
+        return false;
+    }
+
+    DIR* dir = opendir(directory);
+    if (dir == NULL) {
+        std::cout << "Error, could not open the directory " << directory << std::endl;
+        return false;
+    }
+    std::vector<std::string> names;
+    while (dirent* file = readdir(dir)) {
+        if (hasImageExtension(file->d_name)) names.push_back(file->d_name);
+    }
+    closedir(dir);
+
+    // orden fijo, independiente del sistema de archivos
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+        entry.input = std::string(directory) + "/" + name;
+        entry.outputs.assign(1, std::string(outputDirectory) + "/" + name);
+        entries->push_back(entry);
+    }
+    return true;
+}
+
+void allocateBatchResults(BatchItem* item) {
+    Image* image = item->image;
+    for (size_t i = 0; i < item->entry->outputs.size(); i++) {
+        item->results[i] = Image::create(image->getMagicNumber(), image->getMaxColor());
+        item->results[i]->allocate(image->getMagicNumber(), image->getWidth(), image->getHeight(), image->getMaxColor());
+    }
+}
+
+struct BatchPipeline {
+    const std::vector<BatchEntry>* entries;
+    BatchQueue* loaded;
+    BatchQueue* computed;
+    BatchStats stats;
+};
+
+static void* readerMain(void* arg) {
+    BatchPipeline* pipeline = static_cast<BatchPipeline*>(arg);
+    for (const BatchEntry& entry : *pipeline->entries) {
+        double start = monotonicSeconds();
+        BatchItem* item = new BatchItem();
+        item->entry = &entry;
+        item->image = Image::createFromFile(entry.input.c_str());
+        FILE* file = item->image ? fopen(entry.input.c_str(), "r") : NULL;
+        bool loaded = file != NULL && item->image->load(file);
+        if (file != NULL) fclose(file);
+        if (!loaded) {
+            delete item->image;
+            item->image = NULL;
+            item->error = "could not read the input";
+        }
+        pipeline->stats.readSeconds += monotonicSeconds() - start;
+        pipeline->loaded->push(item);
+    }
+    pipeline->loaded->push(NULL);
+    return NULL;
+}
+
+static void* writerMain(void* arg) {
+    BatchPipeline* pipeline = static_cast<BatchPipeline*>(arg);
+    while (BatchItem* item = pipeline->computed->pop()) {
+        double start = monotonicSeconds();
+        const BatchEntry& entry = *item->entry;
+        for (size_t i = 0; item->error == NULL && i < entry.outputs.size(); i++) {
+            item->results[i]->detachInput();
+            FILE* output = fopen(entry.outputs[i].c_str(), "w");
+            if (output == NULL) {
+                item->error = "could not create the output";
+                break;
+            }
+            bool saved = item->results[i]->save(output);
+            if (fclose(output) != 0 || !saved) {
+                item->error = "could not write the output";
+                break;
+            }
+        }
+
+        if (item->error) {
+            std::cout << "Error, " << entry.input << ": " << item->error << std::endl;
+            pipeline->stats.failed++;
+        }
+        pipeline->stats.images++;
+        for (size_t i = 0; i < entry.outputs.size(); i++) {
+            if (item->results[i] != item->image) delete item->results[i];
+        }
+        delete item->image;
+        delete item;
+        pipeline->stats.writeSeconds += monotonicSeconds() - start;
+    }
+    return NULL;
+}
+
+BatchStats runBatch(const std::vector<BatchEntry>& entries, int depth, BatchCompute compute, void* context) {
+    double wallStart = monotonicSeconds();
+    BatchQueue loaded(depth), computed(depth);
+    BatchPipeline pipeline = {&entries, &loaded, &computed, BatchStats{0, 0, 0.0, 0.0, 0.0, 0.0}};
+
+    pthread_t reader, writer;
+    pthread_create(&reader, nullptr, readerMain, &pipeline);
+    pthread_create(&writer, nullptr, writerMain, &pipeline);
+
+    while (BatchItem* item = loaded.pop()) {
+        double start = monotonicSeconds();
+        if (item->error == NULL) compute(item, context);
+        pipeline.stats.computeSeconds += monotonicSeconds() - start;
+        computed.push(item);
+    }
+    computed.push(NULL);
+
+    pthread_join(reader, nullptr);
+    pthread_join(writer, nullptr);
+    pipeline.stats.wallSeconds = monotonicSeconds() - wallStart;
+    return pipeline.stats;
+}
+
+int batchMain(int argc, char* argv[], BatchCompute compute, void* context) {
+    const char* source = argc > 2 ? argv[2] : NULL;
+    const char* filterList = NULL;
+    const char* outputDirectory = NULL;
+    int depth = DEFAULT_BATCH_DEPTH;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--f") == 0 && i + 1 < argc) filterList = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outputDirectory = argv[++i];
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) depth = atoi(argv[++i]);
+    }
+    if (source == NULL || depth <= 0) {
+        std::cout << "Usage:" << argv[0] << " --batch manifest.txt [--depth N]" << std::endl;
+        std::cout << "or " << argv[0] << " --batch directory --f filter1[,filter2...] --out directory [--depth N]" << std::endl;
+        return 1;
+    }
+
+    std::vector<BatchEntry> entries;
+    struct stat info;
+    bool isDirectory = stat(source, &info) == 0 && S_ISDIR(info.st_mode);
+    if (isDirectory && (filterList == NULL || outputDirectory == NULL)) {
+        std::cout << "Error, a batch directory needs --f and --out" << std::endl;
+        return 1;
+    }
+    bool listed = isDirectory ? listBatchDirectory(source, filterList, outputDirectory, &entries)
+                              : loadBatchManifest(source, &entries);
+    if (!listed) return 1;
+
+    BatchStats stats = runBatch(entries, depth, compute, context);
+
+    // cada etapa corre en su hilo: si el pipeline va bien, el tiempo total
+    // se acerca al de la etapa mas lenta y no a la suma de las tres
+    std::cout << "Images: " << stats.images << " (" << stats.failed << " failed)" << std::endl;
+    std::cout << "Read Time: " << stats.readSeconds << " seconds" << std::endl;
+    std::cout << "Filter Time: " << stats.computeSeconds << " seconds" << std::endl;
+    std::cout << "Write Time: " << stats.writeSeconds << " seconds" << std::endl;
+    std::cout << "Total Execution Time: " << stats.wallSeconds << " seconds" << std::endl;
+    return stats.failed > 0 ? 1 : 0;
+}
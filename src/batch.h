@@ -0,0 +1,83 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "filters.h"
+
+class Image;
+
+// Una imagen del lote. Con una salida los filtros se encadenan; con varias,
+// cada filtro se aplica a la entrada y va a su salida.
+struct BatchEntry {
+    std::string input;
+    std::vector<std::string> outputs;
+    Filter filters[MAX_FILTER_CHAIN];
+    int filterCount;
+};
+
+// Imagen en vuelo por el pipeline. El lector rellena image, el calculo
+// deja en results una imagen por salida (puede ser la propia image) y el
+// escritor las guarda y las libera.
+struct BatchItem {
+    const BatchEntry* entry;
+    Image* image;
+    Image* results[MAX_FILTER_CHAIN];
+    const char* error;
+};
+
+struct BatchStats {
+    int images;
+    int failed;
+    double readSeconds;
+    double computeSeconds;
+    double writeSeconds;
+    double wallSeconds;
+};
+
+typedef void (*BatchCompute)(BatchItem* item, void* context);
+
+// Cola acotada entre dos etapas: push espera si esta llena y pop si esta
+// vacia. Un item nulo marca el final.
+class BatchQueue {
+public:
+    explicit BatchQueue(int capacity);
+    BatchQueue(const BatchQueue&) = delete;
+    BatchQueue& operator=(const BatchQueue&) = delete;
+    ~BatchQueue();
+
+    void push(BatchItem* item);
+    BatchItem* pop();
+
+private:
+    std::deque<BatchItem*> items;
+    int capacity;
+    pthread_mutex_t mutex;
+    pthread_cond_t notFull;
+    pthread_cond_t notEmpty;
+};
+
+// Manifiesto: una imagen por linea, "entrada filtro[,filtro...] salida [salida...]".
+// Las lineas vacias y las que empiezan por # se ignoran.
+bool loadBatchManifest(const char* path, std::vector<BatchEntry>* entries);
+// Todas las .pgm/.ppm de un directorio, con la cadena de filtros y la salida
+// del mismo nombre en outputDirectory.
+bool listBatchDirectory(const char* directory, const char* filterList, const char* outputDirectory,
+                        std::vector<BatchEntry>* entries);
+
+// reserva en results una imagen vacia, del tamano de la entrada, por salida
+void allocateBatchResults(BatchItem* item);
+
+// Lee la imagen i+1 mientras compute filtra la i y se escribe la i-1. Lector
+// y escritor tienen su propio hilo y compute se ejecuta en el que llama; cada
+// cola admite depth imagenes, asi que nunca hay mas de 2 * depth + 3 en memoria.
+BatchStats runBatch(const std::vector<BatchEntry>& entries, int depth, BatchCompute compute, void* context);
+
+// Modo --batch de los ejecutables: "--batch manifiesto" o "--batch directorio
+// --f filtros --out directorio", con --depth N opcional. Devuelve el codigo
+// de salida del programa.
+int batchMain(int argc, char* argv[], BatchCompute compute, void* context);
+
+#endif
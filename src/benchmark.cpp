@@ -0,0 +1,377 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unistd.h>
+#include "image.h"
+#include "filters.h"
+#include "backend.h"
+#include "threadpool.h"
+#include "convolution.h"
+
+#define DEFAULT_IMAGES "images/lena.pgm,images/fruit.pgm,images/sulfur.pgm,images/damma.pgm"
+#define DEFAULT_FILTERS "blur,laplace,sharpening,gaussian7"
+#define DEFAULT_BACKENDS "serial,pthreads,openmp,mpi"
+#define DEFAULT_SYNTHETIC "8k,16k"
+#define DEFAULT_REPEATS 5
+#define DEFAULT_WARMUP 1
+
+// Una configuracion medida: imagen x filtro x backend x numero de hilos.
+// Los tiempos son de reloj de pared (clock() suma la CPU de todos los hilos
+// y esconde la aceleracion) y se guardan todas las repeticiones.
+struct Measurement {
+    std::string image;
+    int width;
+    int height;
+    int channels;
+    std::string filter;
+    std::string backend;
+    int workers;
+    std::vector<double> parse;
+    std::vector<double> filterTimes;
+    std::vector<double> write;
+    double serialFilter;    // mediana del backend serial con la misma imagen y filtro
+    bool matches;
+    bool written;           // todas las escrituras medidas terminaron bien
+};
+
+static std::vector<std::string> splitList(const char* list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// percentil por rango mas cercano: el menor valor que deja por debajo al p%
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+static Image* loadImage(const char* path) {
+    Image* image = Image::createFromFile(path);
+    FILE* file = image ? fopen(path, "r") : NULL;
+    if (file == NULL) {
+        delete image;
+        return NULL;
+    }
+    bool loaded = image->load(file);
+    fclose(file);
+    if (!loaded) {
+        delete image;
+        return NULL;
+    }
+    return image;
+}
+
+static Image* allocateLike(const Image* image) {
+    Image* output = Image::create(image->getMagicNumber(), image->getMaxColor());
+    output->allocate(image->getMagicNumber(), image->getWidth(), image->getHeight(), image->getMaxColor());
+    return output;
+}
+
+// "8k" = 7680x4320, "16k" = 15360x8640 o "WxH"
+static bool parseSize(const std::string& name, int* width, int* height) {
+    if (name == "8k") { *width = 7680; *height = 4320; return true; }
+    if (name == "16k") { *width = 15360; *height = 8640; return true; }
+    return sscanf(name.c_str(), "%dx%d", width, height) == 2 && *width > 0 && *height > 0;
+}
+
+// P5 de 8 bits con ruido pseudoaleatorio de semilla fija: el mismo archivo en
+// cada ejecucion, asi que los resultados son comparables
+static bool writeSynthetic(const char* path, int width, int height) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return false;
+    fprintf(file, "P5\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(width);
+    uint32_t state = 12345;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            state = state * 1664525u + 1013904223u;
+            row[x] = (unsigned char)(state >> 24);
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    return fclose(file) == 0;
+}
+
+// Mide una configuracion. En MPI todos los ranks entran en filterAll, pero
+// solo el rank 0 carga, escribe y guarda tiempos.
+static void measure(Backend* backend, const char* path, const Filter& filter, int warmup, int repeats,
+                    const Image* reference, Measurement* result) {
+    bool root = backend->isRoot();
+    for (int run = -warmup; run < repeats; run++) {
+        auto start = std::chrono::steady_clock::now();
+        Image* image = root ? loadImage(path) : NULL;
+        double parse = secondsSince(start);
+
+        Image* output = root ? allocateLike(image) : NULL;
+        start = std::chrono::steady_clock::now();
+        backend->filterAll(image, &filter, 1, &output);
+        double filterSeconds = secondsSince(start);
+
+        double write = 0.0;
+        if (root) {
+            // a un archivo real: se mide el formateo y la escritura, no un pipe
+            start = std::chrono::steady_clock::now();
+            FILE* file = tmpfile();
+            bool saved = file != NULL && output->save(file);
+            if (file != NULL && fclose(file) != 0) saved = false;
+            if (!saved) result->written = false;
+            write = secondsSince(start);
+        }
+
+        if (run >= 0) {
+            result->parse.push_back(parse);
+            result->filterTimes.push_back(filterSeconds);
+            result->write.push_back(write);
+        }
+        if (root && run == repeats - 1) {
+            result->matches = reference == NULL ||
+                              memcmp(output->getRawPixels(), const_cast<Image*>(reference)->getRawPixels(),
+                                     output->getDataSize()) == 0;
+        }
+        delete output;
+        delete image;
+    }
+}
+
+static void printCsv(FILE* out, const std::vector<Measurement>& results, bool header) {
+    if (header) {
+        fprintf(out, "image,width,height,channels,filter,backend,workers,repeats,parse_median,filter_median,"
+                     "filter_p95,write_median,total_median,speedup,efficiency,matches,isa\n");
+    }
+    for (const Measurement& m : results) {
+        double filterMedian = median(m.filterTimes);
+        double speedup = filterMedian > 0 ? m.serialFilter / filterMedian : 0.0;
+        fprintf(out, "%s,%d,%d,%d,%s,%s,%d,%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%s,%s\n", m.image.c_str(), m.width,
+                m.height, m.channels, m.filter.c_str(), m.backend.c_str(), m.workers, m.filterTimes.size(),
+                median(m.parse), filterMedian, percentile(m.filterTimes, 95), median(m.write),
+                median(m.parse) + filterMedian + median(m.write), speedup, speedup / m.workers,
+                m.matches ? "true" : "false", convolutionIsaName());
+    }
+}
+
+static void printJson(FILE* out, const std::vector<Measurement>& results, int warmup) {
+    fprintf(out, "{\n  \"machine\": {\"hardware_threads\": %d, \"isa\": \"%s\"},\n  \"warmup\": %d,\n",
+            ThreadPool::hardwareThreads(), convolutionIsaName(), warmup);
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Measurement& m = results[i];
+        double filterMedian = median(m.filterTimes);
+        double speedup = filterMedian > 0 ? m.serialFilter / filterMedian : 0.0;
+        fprintf(out, "    {\"image\": \"%s\", \"width\": %d, \"height\": %d, \"channels\": %d, \"filter\": \"%s\", "
+                     "\"backend\": \"%s\", \"workers\": %d, \"repeats\": %zu,\n", m.image.c_str(), m.width, m.height,
+                m.channels, m.filter.c_str(), m.backend.c_str(), m.workers, m.filterTimes.size());
+        fprintf(out, "     \"parse_seconds\": {\"median\": %.6f, \"p95\": %.6f}, "
+                     "\"filter_seconds\": {\"median\": %.6f, \"p95\": %.6f}, "
+                     "\"write_seconds\": {\"median\": %.6f, \"p95\": %.6f},\n", median(m.parse), percentile(m.parse, 95),
+                filterMedian, percentile(m.filterTimes, 95), median(m.write), percentile(m.write, 95));
+        fprintf(out, "     \"speedup\": %.3f, \"efficiency\": %.3f, \"matches\": %s}%s\n", speedup,
+                speedup / m.workers, m.matches ? "true" : "false", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* imageList = DEFAULT_IMAGES;
+    const char* syntheticList = DEFAULT_SYNTHETIC;
+    const char* filterList = DEFAULT_FILTERS;
+    const char* backendList = DEFAULT_BACKENDS;
+    const char* threadList = NULL;
+    const char* format = "csv";
+    const char* outputPath = NULL;
+    int repeats = DEFAULT_REPEATS;
+    int warmup = DEFAULT_WARMUP;
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--images") == 0 && i + 1 < argc) imageList = argv[++i];
+        else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) syntheticList = argv[++i];
+        else if (strcmp(argv[i], "--filters") == 0 && i + 1 < argc) filterList = argv[++i];
+        else if (strcmp(argv[i], "--backends") == 0 && i + 1 < argc) backendList = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threadList = argv[++i];
+        else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) repeats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) format = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) outputPath = argv[++i];
+        else if (strcmp(argv[i], "--no-header") == 0) header = false;
+        else {
+            std::cout << "Usage:" << argv[0] << " [--images a.pgm,b.ppm] [--synthetic 8k,16k,WxH] [--filters blur,...]"
+                      << " [--backends " << availableBackends() << "] [--threads 1,2,4] [--repeats N] [--warmup N]"
+                      << " [--format csv|json] [--output file] [--no-header]" << std::endl;
+            return 1;
+        }
+    }
+    if (repeats <= 0 || warmup < 0 || (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0)) {
+        std::cout << "Error, --repeats must be positive and --format csv or json" << std::endl;
+        return 1;
+    }
+
+    // hilos por defecto: 1, 2, 4... hasta los nucleos de la maquina
+    std::vector<int> threadCounts;
+    if (threadList) {
+        for (const std::string& t : splitList(threadList)) threadCounts.push_back(std::max(1, atoi(t.c_str())));
+    } else {
+        for (int t = 1; t < ThreadPool::hardwareThreads(); t *= 2) threadCounts.push_back(t);
+        threadCounts.push_back(ThreadPool::hardwareThreads());
+    }
+
+    std::vector<std::string> filterNames = splitList(filterList);
+    std::vector<Filter> filters(filterNames.size());
+    for (size_t i = 0; i < filterNames.size(); i++) {
+        if (!parseFilter(filterNames[i].c_str(), &filters[i])) {
+            std::cout << "Error, wrong filter " << filterNames[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // MPI se inicia una vez para toda la ejecucion; sin mpirun es un solo rank
+    std::vector<std::string> backends = splitList(backendList);
+    Backend* mpi = NULL;
+    if (std::find(backends.begin(), backends.end(), "mpi") != backends.end()) mpi = createBackend("mpi", 0);
+    bool root = mpi == NULL || mpi->isRoot();
+
+    // rutas y nombres en el informe (las sinteticas viven en un directorio temporal)
+    std::vector<std::string> images = splitList(imageList);
+    std::vector<std::string> labels = images;
+    std::vector<std::string> synthetic;
+    char directory[] = "/tmp/benchmarkXXXXXX";
+    bool haveDirectory = false;
+    for (const std::string& size : splitList(syntheticList)) {
+        int width, height;
+        if (!parseSize(size, &width, &height)) {
+            if (root) std::cout << "Error, wrong synthetic size " << size << std::endl;
+            delete mpi;
+            return 1;
+        }
+        if (root && !haveDirectory) haveDirectory = mkdtemp(directory) != NULL;
+        std::string path = std::string(directory) + "/synthetic_" + size + ".pgm";
+        if (root && (!haveDirectory || !writeSynthetic(path.c_str(), width, height))) {
+            std::cout << "Error, could not write " << path << std::endl;
+        }
+        images.push_back(path);
+        labels.push_back("synthetic_" + size);
+        synthetic.push_back(path);
+    }
+
+    std::vector<Measurement> results;
+    for (size_t n = 0; n < images.size(); n++) {
+        const std::string& path = images[n];
+        Image* input = root ? loadImage(path.c_str()) : NULL;
+        bool loaded = mpi ? mpi->agree(input != NULL) : input != NULL;
+        if (!loaded) {
+            if (root) std::cerr << "Skipping " << path << ": could not read it" << std::endl;
+            continue;
+        }
+        Measurement base;
+        base.image = labels[n];
+        base.width = root ? input->getWidth() : 0;
+        base.height = root ? input->getHeight() : 0;
+        base.channels = root ? input->getChannels() : 0;
+
+        for (size_t f = 0; f < filters.size(); f++) {
+            // referencia: el backend serial, sin medir
+            Image* reference = NULL;
+            if (root) {
+                Backend* serial = createBackend("serial", 1);
+                reference = allocateLike(input);
+                serial->filterAll(input, &filters[f], 1, &reference);
+                delete serial;
+            }
+
+            for (const std::string& name : backends) {
+                bool threaded = name == "pthreads" || name == "openmp";
+                std::vector<int> counts = threaded ? threadCounts : std::vector<int>(1, 1);
+                for (int threads : counts) {
+                    // solo el backend mpi necesita a todos los ranks
+                    if (name != "mpi" && !root) continue;
+                    Backend* backend = name == "mpi" ? mpi : createBackend(name.c_str(), threads);
+                    if (backend == NULL) {
+                        if (root) std::cerr << "Skipping backend " << name << ": not built in" << std::endl;
+                        break;
+                    }
+                    if (root) {
+                        std::cerr << labels[n] << " " << filterNames[f] << " " << name << " x" << backend->getWorkers()
+                                  << std::endl;
+                    }
+
+                    Measurement m = base;
+                    m.filter = filterNames[f];
+                    m.backend = name;
+                    m.workers = backend->getWorkers();
+                    m.matches = true;
+                    m.written = true;
+                    m.serialFilter = 0.0;
+                    measure(backend, path.c_str(), filters[f], warmup, repeats, reference, &m);
+                    if (root) results.push_back(m);
+                    if (backend != mpi) delete backend;
+                }
+            }
+            delete reference;
+        }
+        delete input;
+    }
+
+    // aceleracion respecto al serial de la misma imagen y filtro (0 si no se midio)
+    for (Measurement& m : results) {
+        for (const Measurement& s : results) {
+            if (s.backend == "serial" && s.image == m.image && s.filter == m.filter) {
+                m.serialFilter = median(s.filterTimes);
+            }
+        }
+    }
+
+    bool ok = true;
+    if (root) {
+        FILE* out = outputPath ? fopen(outputPath, "w") : stdout;
+        if (out == NULL) {
+            std::cout << "Error, could not create " << outputPath << std::endl;
+            ok = false;
+        } else {
+            if (strcmp(format, "json") == 0) printJson(out, results, warmup);
+            else printCsv(out, results, header);
+            if (fflush(out) != 0 || (out != stdout && fclose(out) != 0)) {
+                std::cout << "Error, could not write " << (outputPath ? outputPath : "the results") << std::endl;
+                ok = false;
+            }
+        }
+        for (const Measurement& m : results) {
+            if (!m.written) {
+                std::cerr << "Error, " << m.backend << " x" << m.workers << " could not write the output of "
+                          << m.image << " " << m.filter << std::endl;
+                ok = false;
+            }
+            if (!m.matches) {
+                std::cerr << "Error, " << m.backend << " x" << m.workers << " differs from serial on " << m.image
+                          << " " << m.filter << std::endl;
+                ok = false;
+            }
+        }
+        for (const std::string& path : synthetic) unlink(path.c_str());
+        if (haveDirectory) rmdir(directory);
+    }
+    delete mpi;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Suite completa: benchmark con serial, pthreads y openmp para 1, 2, 4...
+# hilos y despues con mpi para cada numero de ranks, todo en un mismo CSV.
+# Uso: ./benchmark_suite.sh [resultados.csv] [ranks...]   (desde la raiz del repositorio)
+# MPIRUN permite pasar opciones extra, p.ej. MPIRUN="mpirun --oversubscribe"
+# ARGS se pasa tal cual a benchmark, p.ej. ARGS="--synthetic 8k --repeats 10"
+
+CSV=${1:-benchmark.csv}
+shift
+RANKS=${@:-1 2 4 8}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./benchmark}
+
+$BIN --backends serial,pthreads,openmp $ARGS --output $CSV || exit 1
+for np in $RANKS; do
+  # cada ejecucion repite el serial para tener su propia referencia
+  $MPIRUN -np $np $BIN --backends serial,mpi $ARGS --no-header | grep ",mpi," >> $CSV || exit 1
+done
+
+# resumen: mejor aceleracion de cada backend por imagen y filtro
+awk -F, 'NR > 1 && $16 == "false" {bad++}
+         NR > 1 {key = $1 " " $5 " " $6; if ($14 > best[key]) {best[key] = $14; at[key] = $7}}
+         END {for (k in best) printf "%-40s %8.2fx with %d workers\n", k, best[k], at[k]
+              if (bad) {print bad " configurations differ from serial"; exit 1}}' $CSV | sort
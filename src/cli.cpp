@@ -0,0 +1,94 @@
+#include "cli.h"
+#include "image.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+int countOutputPaths(int argc, char* argv[]) {
+    int count = 0;
+    while (2 + count < argc && strncmp(argv[2 + count], "--", 2) != 0) count++;
+    return count;
+}
+
+// Por que parseFilterChain rechazo la lista: el primer nombre que no es un
+// filtro, demasiados filtros o ninguno.
+static void reportFilterChain(const char* filterList) {
+    std::vector<char> names(filterList, filterList + strlen(filterList) + 1);
+    int count = 0;
+    char* save = NULL;
+    Filter filter;
+    for (char* name = strtok_r(names.data(), ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        if (!parseFilter(name, &filter)) {
+            std::cout << "Error, wrong filter " << name << ". Use blur, laplace, sharpening, gaussian5, gaussian7, sobelx, sobely or unsharp" << std::endl;
+            std::cout << "Several filters can be chained with commas, e.g. --f blur,sharpening" << std::endl;
+            return;
+        }
+        count++;
+    }
+    if (count > MAX_FILTER_CHAIN) {
+        std::cout << "Error, at most " << MAX_FILTER_CHAIN << " filters can be chained" << std::endl;
+    } else {
+        std::cout << "Error, --f needs at least one filter" << std::endl;
+    }
+}
+
+int parseFilterOptions(const char* filterList, const char* kernelFile, Filter* filters, bool report) {
+    if (kernelFile != NULL) {
+        if (!loadFilterKernel(kernelFile, &filters[0])) {
+            if (report) std::cout << "Error, could not read the kernel file " << kernelFile << std::endl;
+            return -1;
+        }
+        return 1;
+    }
+    if (filterList == NULL) {
+        if (report) std::cout << "Error, must specify a filter with --f or --kernel" << std::endl;
+        return -1;
+    }
+    int count = parseFilterChain(filterList, filters, MAX_FILTER_CHAIN);
+    if (count < 0 && report) reportFilterChain(filterList);
+    return count;
+}
+
+Image* loadImageFile(const char* path) {
+    Image* image = Image::createFromFile(path);
+    if (image == NULL) {
+        std::cout << "Error, incorrect path or incorrect file." << std::endl;
+        return NULL;
+    }
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        std::cout << "Error, could not open the input file." << std::endl;
+        delete image;
+        return NULL;
+    }
+    bool loaded = image->load(file);
+    fclose(file);
+    if (!loaded) {
+        std::cout << "Error, incorrect path or incorrect file." << std::endl;
+        delete image;
+        return NULL;
+    }
+    return image;
+}
+
+bool saveImageFile(Image* image, const char* path) {
+    image->detachInput();
+    FILE* output = fopen(path, "w");
+    if (output == NULL) {
+        std::cout << "Error, could not create the output file " << path << std::endl;
+        return false;
+    }
+    bool saved = image->save(output);
+    // fclose tambien puede fallar al vaciar lo que quede en el buffer
+    if (fclose(output) != 0) saved = false;
+    if (!saved) std::cout << "Error, could not write the output file " << path << std::endl;
+    return saved;
+}
+
+void printRunTimes(double cpuSeconds, double wallSeconds, double parseThroughput) {
+    std::cout << "CPU Time (applying the filter only): " << cpuSeconds << " seconds" << std::endl;
+    std::cout << "Total Execution Time: " << wallSeconds << " seconds" << std::endl;
+    if (parseThroughput > 0) {
+        std::cout << "Parse throughput: " << parseThroughput << " MB/s" << std::endl;
+    }
+}
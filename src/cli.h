@@ -0,0 +1,28 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include "filters.h"
+
+class Image;
+
+// Piezas comunes de los programas (filterer, pth_filterer, omp_filterer,
+// mpi_filterer y backendMain). Las que pueden fallar imprimen su "Error, ..."
+// y devuelven el fallo; el programa solo tiene que terminar con 1.
+
+// Rutas de salida: los argumentos desde argv[2] hasta la primera opcion "--".
+int countOutputPaths(int argc, char* argv[]);
+
+// El kernel de --kernel o, si no hay, los filtros de --f separados por
+// comas. Devuelve cuantos filtros hay o -1. Con report false no imprime el
+// error (los ranks de MPI distintos del 0).
+int parseFilterOptions(const char* filterList, const char* kernelFile, Filter* filters, bool report = true);
+
+// Crea y carga la imagen completa; NULL si no se pudo.
+Image* loadImageFile(const char* path);
+// Guarda image en path; false si no se pudo crear o escribir entero.
+bool saveImageFile(Image* image, const char* path);
+
+// Las lineas de tiempos de todos los programas; sin la de parseo si es 0.
+void printRunTimes(double cpuSeconds, double wallSeconds, double parseThroughput);
+
+#endif
@@ -0,0 +1,41 @@
+#include "convolution.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static ConvolutionIsa detectIsa() {
+    ConvolutionIsa best = ISA_SCALAR;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    // las muestras de 8 y 16 bits necesitan AVX-512BW ademas de la base F
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) best = ISA_AVX512;
+    else if (__builtin_cpu_supports("avx2")) best = ISA_AVX2;
+    else if (__builtin_cpu_supports("sse4.1")) best = ISA_SSE41;
+#endif
+
+    // FILTER_ISA permite forzar una ruta mas simple para comparar resultados
+    const char* forced = getenv("FILTER_ISA");
+    if (forced) {
+        ConvolutionIsa wanted = best;
+        if (strcmp(forced, "scalar") == 0) wanted = ISA_SCALAR;
+        else if (strcmp(forced, "sse4") == 0) wanted = ISA_SSE41;
+        else if (strcmp(forced, "avx2") == 0) wanted = ISA_AVX2;
+        else if (strcmp(forced, "avx512") == 0) wanted = ISA_AVX512;
+        best = std::min(best, wanted);
+    }
+    return best;
+}
+
+ConvolutionIsa convolutionIsa() {
+    static const ConvolutionIsa isa = detectIsa();
+    return isa;
+}
+
+const char* convolutionIsaName() {
+    switch (convolutionIsa()) {
+        case ISA_AVX512: return "avx512";
+        case ISA_AVX2: return "avx2";
+        case ISA_SSE41: return "sse4";
+        default: return "scalar";
+    }
+}
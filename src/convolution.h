@@ -0,0 +1,49 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_SIMD 1
+#endif
+
+enum ConvolutionIsa {
+    ISA_SCALAR = 0,
+    ISA_SSE41,
+    ISA_AVX2,
+    ISA_AVX512
+};
+
+ConvolutionIsa convolutionIsa();
+const char* convolutionIsaName();
+
+// Atributos de cada copia de una funcion de filtro. La escalar se compila
+// sin vectorizar (con GCC) para comparar; fuera de x86 todas las copias son
+// la misma funcion compilada para la arquitectura por defecto.
+#if defined(HAVE_X86_SIMD) && defined(__GNUC__) && !defined(__clang__)
+#define ISA_TARGET_SCALAR __attribute__((optimize("no-tree-vectorize")))
+#else
+#define ISA_TARGET_SCALAR
+#endif
+#ifdef HAVE_X86_SIMD
+#define ISA_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define ISA_TARGET_AVX2 __attribute__((target("avx2")))
+#define ISA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define ISA_TARGET_SSE41
+#define ISA_TARGET_AVX2
+#define ISA_TARGET_AVX512
+#endif
+
+// la copia del nivel que ha elegido convolutionIsa()
+template <typename Function>
+inline Function isaSelect(Function scalar, Function sse41, Function avx2, Function avx512) {
+    switch (convolutionIsa()) {
+        case ISA_AVX512: return avx512;
+        case ISA_AVX2: return avx2;
+        case ISA_SSE41: return sse41;
+        default: return scalar;
+    }
+}
+
+#endif
@@ -5,78 +5,104 @@
 #include "image.h"
 #include "pgmimage.h"
 #include "ppmimage.h"
+#include "netpbm.h"
+#include "filters.h"
+#include "batch.h"
+#include "stream.h"
+#include "backend.h"
+#include "cli.h"
 
 #define MAX_FILENAME 256
 #define BUFFER_SIZE 1024
 
 int main(int argc, char* argv[]) {
 
+  // --backend: el mismo programa con cualquier estrategia de ejecucion
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--backend") == 0) return backendMain(argc, argv, NULL, NULL);
+  }
+
+  if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+    Backend* serial = createBackend("serial", 1);
+    int code = batchMain(argc, argv, backendBatchItem, serial);
+    delete serial;
+    return code;
+  }
+
   if(argc<4){
     std::cout << "Missing input and output paths\n";
-    std::cout << "Usage:" << argv[0] << " input_image.pgm output_image.pgm --f [blur|laplace|sharpening]" << std::endl;
-    std::cout << "or "<< argv[0] << "input_image.ppm output_image.ppm --f [blur|laplace|sharpening]" << std::endl;
+    std::cout << "Usage:" << argv[0] << " input_image.pgm output_image.pgm --f [blur|laplace|sharpening|gaussian5|gaussian7|sobelx|sobely|unsharp][,...]" << std::endl;
+    std::cout << "or "<< argv[0] << "input_image.ppm output_image.ppm --kernel file.k" << std::endl;
+    std::cout << "or "<< argv[0] << " input_image output_image --f filters --stream | --tiled | --planar" << std::endl;
+    std::cout << "or "<< argv[0] << " input_image output_image --f filters --backend " << availableBackends() << " [--threads N]" << std::endl;
+    std::cout << "or "<< argv[0] << " --batch manifest.txt | --batch directory --f filters --out directory" << std::endl;
     return 1;
   }
 
-  auto wall_start = std::chrono::high_resolution_clock::now();
-
   const char* filterType = nullptr;
+  const char* kernelFile = nullptr;
+  bool stream = false;
+  bool tiled = false;
+  bool planar = false;
   for (int i = 3; i < argc; i++) {
       if (strcmp(argv[i], "--f") == 0 && i + 1 < argc) {
-          filterType = argv[i + 1];
-          break;
+          filterType = argv[++i];
+      } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+          kernelFile = argv[++i];
+      } else if (strcmp(argv[i], "--stream") == 0) {
+          stream = true;
+      } else if (strcmp(argv[i], "--tiled") == 0) {
+          tiled = true;
+      } else if (strcmp(argv[i], "--planar") == 0) {
+          planar = true;
       }
   }
-  if (filterType == NULL) {
-    std::cout << "Error, must specify a filter with --f" << std::endl;
-    return 1;
-  }
-  if (strcmp(filterType, "blur") != 0 && 
-    strcmp(filterType, "laplace") != 0 && 
-    strcmp(filterType, "sharpening") != 0) {
-    std::cout << "Error, wrong filter. Use blur, laplace or sharpening" << std::endl;
-    return 1;
-  }
 
-  // abrir archivo
-  Image* image = Image::createFromFile(argv[1]);
-  if (image == NULL) {
-      std::cout << "Error, incorrect path or incorrect file." << std::endl;
-      return 1;
+  // por filas es el programa comun con el backend serial
+  if (!stream && !tiled && !planar) {
+    Backend* serial = createBackend("serial", 1);
+    int code = backendMain(argc, argv, serial, NULL);
+    delete serial;
+    return code;
   }
 
-  FILE *file = fopen(argv[1], "r");
-  if (file == NULL) {
-    std::cout << "Error, could not open the input file."<< std::endl;
-    delete image;
-    return 1;
+  auto wall_start = std::chrono::high_resolution_clock::now();
+
+  Filter filters[MAX_FILTER_CHAIN];
+  int filterCount = parseFilterOptions(filterType, kernelFile, filters);
+  if (filterCount < 0) return 1;
+
+  // por flujo la imagen nunca esta entera en memoria: lectura, filtro y
+  // escritura van a la vez, fila a fila
+  if (stream) {
+    StreamStats stats;
+    if (!streamFilterChain(argv[1], argv[2], filters, filterCount, &stats)) {
+      std::cout << "Error, could not stream " << argv[1] << " into " << argv[2] << std::endl;
+      return 1;
+    }
+    std::chrono::duration<double> stream_time = std::chrono::high_resolution_clock::now() - wall_start;
+    std::cout << "Streamed: " << stats.width << "x" << stats.height << ", buffers " << stats.bufferBytes / 1024.0 << " KB" << std::endl;
+    std::cout << "Total Execution Time: " << stream_time.count() << " seconds" << std::endl;
+    return 0;
   }
 
-  image->load(file);
-  fclose(file);
+  Image* image = loadImageFile(argv[1]);
+  if (image == NULL) return 1;
+  double parseThroughput = image->getParseThroughput();
 
   clock_t cpu_start = clock();
-  image->applyFilter(filterType);
+  if (tiled) image->applyFilterChainTiled(filters, filterCount);
+  else image->applyFilterChainPlanar(filters, filterCount, false);
   clock_t cpu_end = clock();
   double cpu_time = double(cpu_end - cpu_start) / CLOCKS_PER_SEC;
 
-  FILE *output = fopen(argv[2], "w");
-  if (output == NULL) {
-    std::cout << "Error, could not create the output file."<< std::endl;
-    delete image;
-    return 1;
-  }
-
-  image->save(output);
-  fclose(output);
+  bool saved = saveImageFile(image, argv[2]);
+  delete image;
+  if (!saved) return 1;
 
   auto wall_end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> wall_time = wall_end - wall_start;
+  printRunTimes(cpu_time, wall_time.count(), parseThroughput);
 
-  delete image;
-
-  std::cout << "CPU Time (applying the filter only): " << cpu_time << " seconds" << std::endl;
-  std::cout << "Total Execution Time: " << wall_time.count() << " seconds" << std::endl;
-  
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,592 @@
+#if defined(__GNUC__) && !defined(__clang__)
+// los bucles de fila son cortos y simples: vectorizarlos aunque -O2 no lo haga
+#pragma GCC optimize("tree-vectorize", "vect-cost-model=dynamic")
+#endif
+
+#include "filters.h"
+#include "kernels.h"
+#include "convolution.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
+
+bool parseFilter(const char* name, Filter* filter) {
+    if (strcmp(name, "blur") == 0) filter->type = FILTER_BLUR;
+    else if (strcmp(name, "laplace") == 0) filter->type = FILTER_LAPLACE;
+    else if (strcmp(name, "sharpening") == 0) filter->type = FILTER_SHARPEN;
+    else if (Kernel::builtin(name, &filter->kernel)) filter->type = FILTER_KERNEL;
+    else return false;
+    return true;
+}
+
+bool loadFilterKernel(const char* path, Filter* filter) {
+    if (!Kernel::loadFromFile(path, &filter->kernel)) return false;
+    filter->type = FILTER_KERNEL;
+    return true;
+}
+
+int parseFilterChain(const char* list, Filter* filters, int maxFilters) {
+    std::vector<char> names(list, list + strlen(list) + 1);
+    int count = 0;
+    char* save = nullptr;
+    for (char* name = strtok_r(names.data(), ",", &save); name; name = strtok_r(nullptr, ",", &save)) {
+        if (count == maxFilters || !parseFilter(name, &filters[count])) return -1;
+        count++;
+    }
+    return count > 0 ? count : -1;
+}
+
+int filterRadius(const Filter& filter) {
+    return filter.type == FILTER_KERNEL ? filter.kernel.getRadius() : 1;
+}
+
+template <typename Sample>
+static inline Sample clampSample(int value, int maxColor, bool absolute) {
+    if (absolute) value = std::abs(value);
+    return static_cast<Sample>(std::max(0, std::min(maxColor, value)));
+}
+
+#define INLINE_ROW inline __attribute__((always_inline))
+
+// Bucles de fila sin dependencias entre iteraciones: omp simd cuando se
+// compila con -fopenmp o -fopenmp-simd (HAVE_OPENMP_SIMD) y la pista
+// equivalente del compilador si no. vector es false en la copia escalar, que
+// asi no se vectoriza a la fuerza.
+#define SIMD_PRAGMA(text) _Pragma(#text)
+#if defined(_OPENMP) || defined(HAVE_OPENMP_SIMD)
+#define SIMD_LOOP(vector) SIMD_PRAGMA(omp simd if(vector))
+#elif defined(__clang__)
+#define SIMD_LOOP(vector) _Pragma("clang loop vectorize(enable)")
+#elif defined(__GNUC__)
+#define SIMD_LOOP(vector) _Pragma("GCC ivdep")
+#else
+#define SIMD_LOOP(vector)
+#endif
+
+// NAME##Scalar, NAME##Sse41, NAME##Avx2 y NAME##Avx512: el mismo cuerpo CALL
+// compilado para cada nivel de ISA, con Vector a false solo en la copia
+// escalar. ISA_SELECT devuelve la copia del nivel elegido al arrancar.
+#define ISA_VARIANTS(NAME, PARAMS, CALL, ...)                                                                         \
+    template <__VA_ARGS__> ISA_TARGET_SCALAR static void NAME##Scalar PARAMS { constexpr bool Vector = false; CALL; } \
+    template <__VA_ARGS__> ISA_TARGET_SSE41 static void NAME##Sse41 PARAMS { constexpr bool Vector = true; CALL; }    \
+    template <__VA_ARGS__> ISA_TARGET_AVX2 static void NAME##Avx2 PARAMS { constexpr bool Vector = true; CALL; }      \
+    template <__VA_ARGS__> ISA_TARGET_AVX512 static void NAME##Avx512 PARAMS { constexpr bool Vector = true; CALL; }
+#define ISA_SELECT(NAME, ...) \
+    isaSelect(NAME##Scalar<__VA_ARGS__>, NAME##Sse41<__VA_ARGS__>, NAME##Avx2<__VA_ARGS__>, NAME##Avx512<__VA_ARGS__>)
+#define FUSED_BAND_ROWS 16
+#define CHAIN_BAND_ROWS 16
+
+template <typename Stencil, typename Sample, bool Absolute, bool Vector>
+static INLINE_ROW void stencilInterior(const Sample* __restrict above, const Sample* __restrict row,
+                                       const Sample* __restrict below, Sample* __restrict out,
+                                       int begin, int end, int step, int maxColor) {
+    SIMD_LOOP(Vector)
+    for (int i = begin; i < end; i++) {
+        out[i - begin] = clampSample<Sample>(Stencil::apply(above, row, below, i, step), maxColor, Absolute);
+    }
+}
+
+ISA_VARIANTS(stencilInteriorIsa,
+             (const Sample* above, const Sample* row, const Sample* below, Sample* out, int begin, int end,
+              int step, int maxColor),
+             (stencilInterior<Stencil, Sample, Absolute, Vector>(above, row, below, out, begin, end, step, maxColor)),
+             typename Stencil, typename Sample, bool Absolute)
+
+template <typename Stencil, typename Sample>
+static void stencilRegion(const Sample* src, Sample* dst, int dstStride, int width, int height, int channels,
+                          int maxColor, bool absolute, int y0, int y1, int x0, int x1) {
+    typedef void (*Interior)(const Sample*, const Sample*, const Sample*, Sample*, int, int, int, int);
+    Interior interior = absolute ? ISA_SELECT(stencilInteriorIsa, Stencil, Sample, true)
+                                 : ISA_SELECT(stencilInteriorIsa, Stencil, Sample, false);
+
+    size_t rowLength = (size_t)width * channels;
+    std::vector<Sample> zeros;
+    if (y0 == 0 || y1 == height) zeros.assign(rowLength, 0);
+
+    int begin = x0 * channels;
+    int end = x1 * channels;
+    int last = (width - 1) * channels;
+    int interiorBegin = std::max(begin, channels);
+    int interiorEnd = std::min(end, last);
+
+    for (int y = y0; y < y1; y++) {
+        const Sample* above = y > 0 ? src + (y - 1) * rowLength : zeros.data();
+        const Sample* row = src + y * rowLength;
+        const Sample* below = y < height - 1 ? src + (y + 1) * rowLength : zeros.data();
+        Sample* out = dst + (size_t)(y - y0) * dstStride;
+
+        for (int i = begin; i < std::min(end, channels); i++) {
+            int sum = Stencil::applyClipped(above, row, below, i, channels, false, width > 1);
+            out[i - begin] = clampSample<Sample>(sum, maxColor, absolute);
+        }
+        if (interiorBegin < interiorEnd) {
+            interior(above, row, below, out + (interiorBegin - begin), interiorBegin, interiorEnd, channels, maxColor);
+        }
+        for (int i = std::max(begin, std::max(last, channels)); i < end; i++) {
+            int sum = Stencil::applyClipped(above, row, below, i, channels, true, false);
+            out[i - begin] = clampSample<Sample>(sum, maxColor, absolute);
+        }
+    }
+}
+
+// Media de una ventana (2R+1)x(2R+1) con relleno de ceros, por sumas
+// acumuladas: las sumas por columna se actualizan sumando la fila que entra y
+// restando la que sale, y a lo largo de la fila cada ventana es la diferencia
+// de dos sumas prefijas. El coste por pixel no depende del radio.
+template <bool Vector, typename Sample>
+static INLINE_ROW void addRow(uint32_t* __restrict columns, const Sample* __restrict row, int count) {
+    SIMD_LOOP(Vector)
+    for (int i = 0; i < count; i++) columns[i] += row[i];
+}
+
+template <bool Vector, typename Sample>
+static INLINE_ROW void subtractRow(uint32_t* __restrict columns, const Sample* __restrict row, int count) {
+    SIMD_LOOP(Vector)
+    for (int i = 0; i < count; i++) columns[i] -= row[i];
+}
+
+// prefix[s + C] = prefix[s] + columns[s]; con aritmetica modular de 32 bits
+// las diferencias siguen siendo exactas aunque el prefijo desborde
+static INLINE_ROW void prefixRow(uint32_t* __restrict prefix, const uint32_t* __restrict columns,
+                                 int first, int last, int channels) {
+    for (int c = 0; c < channels; c++) {
+        uint32_t running = 0;
+        prefix[first + c] = 0;
+        for (int s = first + c; s < last; s += channels) {
+            running += columns[s];
+            prefix[s + channels] = running;
+        }
+    }
+}
+
+template <int Radius, bool Vector, typename Sample>
+static INLINE_ROW void boxRow(const uint32_t* __restrict prefix, Sample* __restrict out, int begin, int count,
+                              int channels, int maxColor) {
+    const uint32_t area = (2 * Radius + 1) * (2 * Radius + 1);
+    const uint32_t* __restrict right = prefix + begin + (2 * Radius + 1) * channels;
+    const uint32_t* __restrict left = prefix + begin;
+    SIMD_LOOP(Vector)
+    for (int i = 0; i < count; i++) {
+        uint32_t value = (right[i] - left[i]) / area;
+        out[i] = static_cast<Sample>(std::min<uint32_t>(value, maxColor));
+    }
+}
+
+template <int Radius, bool Vector, typename Sample>
+static INLINE_ROW void boxBlurRows(const Sample* src, Sample* dst, int dstStride, int width, int height, int channels,
+                                   int maxColor, int y0, int y1, int x0, int x1) {
+    size_t rowLength = (size_t)width * channels;
+
+    // columnas de la region mas el radio a cada lado, contando desde la
+    // columna x0 - Radius; las que caen fuera de la imagen se quedan en cero
+    int origin = x0 - Radius;
+    int span = (x1 - x0 + 2 * Radius) * channels;
+    std::vector<uint32_t> columns(span, 0);
+    std::vector<uint32_t> prefix(span + channels, 0);
+    int columnX0 = std::max(0, x0 - Radius);
+    int columnX1 = std::min(width, x1 + Radius);
+    uint32_t* active = columns.data() + (columnX0 - origin) * channels;
+    int activeCount = (columnX1 - columnX0) * channels;
+    int offset = columnX0 * channels;
+
+    for (int y = std::max(0, y0 - Radius); y <= std::min(height - 1, y0 + Radius); y++) {
+        addRow<Vector>(active, src + y * rowLength + offset, activeCount);
+    }
+
+    for (int y = y0; y < y1; y++) {
+        if (y > y0) {
+            if (y + Radius < height) addRow<Vector>(active, src + (y + Radius) * rowLength + offset, activeCount);
+            if (y - Radius - 1 >= 0) subtractRow<Vector>(active, src + (y - Radius - 1) * rowLength + offset, activeCount);
+        }
+        prefixRow(prefix.data(), columns.data(), 0, span, channels);
+        boxRow<Radius, Vector>(prefix.data(), dst + (size_t)(y - y0) * dstStride, 0, (x1 - x0) * channels, channels, maxColor);
+    }
+}
+
+ISA_VARIANTS(boxBlurIsa,
+             (const Sample* src, Sample* dst, int dstStride, int width, int height, int channels, int maxColor,
+              int y0, int y1, int x0, int x1),
+             (boxBlurRows<Radius, Vector>(src, dst, dstStride, width, height, channels, maxColor, y0, y1, x0, x1)),
+             int Radius, typename Sample)
+
+template <int Radius, typename Sample>
+static void boxBlurRegion(const Sample* src, Sample* dst, int dstStride, int width, int height, int channels,
+                          int maxColor, int y0, int y1, int x0, int x1) {
+    static_assert(Radius >= 1 && Radius <= 16, "box radius out of range");
+    ISA_SELECT(boxBlurIsa, Radius, Sample)(src, dst, dstStride, width, height, channels, maxColor, y0, y1, x0, x1);
+}
+
+// Motor general para kernels NxN. Cada fila de salida se acumula en enteros
+// de 32 bits como una serie de "acc += peso * fila desplazada", un bucle por
+// tap no nulo que el compilador vectoriza. Los bordes no necesitan casos
+// especiales: cada tap solo recorre las columnas en las que cae dentro de la
+// imagen (relleno de ceros) y las filas fuera de la imagen se saltan.
+template <bool Vector, typename Source>
+static INLINE_ROW void accumulateRow(int32_t* __restrict acc, const Source* __restrict src, int weight, int count) {
+    SIMD_LOOP(Vector)
+    for (int i = 0; i < count; i++) acc[i] += weight * static_cast<int32_t>(src[i]);
+}
+
+// acc[x - x0] += sum_k weights[k] * row[x + k - R] sobre las columnas [x0, x1)
+template <bool Vector, typename Source>
+static INLINE_ROW void kernelRow(int32_t* acc, const Source* row, const int* weights, int size,
+                                 int width, int channels, int x0, int x1) {
+    int radius = size / 2;
+    for (int k = 0; k < size; k++) {
+        if (weights[k] == 0) continue;
+        int dx = k - radius;
+        int first = std::max(x0, -dx);
+        int last = std::min(x1, width - dx);
+        if (first >= last) continue;
+        accumulateRow<Vector>(acc + (first - x0) * channels, row + (first + dx) * channels, weights[k], (last - first) * channels);
+    }
+}
+
+// Division exacta por el divisor con una multiplicacion y un desplazamiento
+// (Granlund y Montgomery): con l = ceil(log2 d) y m = ceil(2^(31+l) / d), que
+// cabe en 32 bits, (n * m) >> (31 + l) == n / d para todo 0 <= n < 2^31. Los
+// pesos limitan |acc| a menos de 2^31, asi que el cociente truncado hacia cero
+// es el de la division entera de C, sin pasar por coma flotante, y el producto
+// de 32x32 bits se vectoriza.
+template <typename Sample, bool Absolute, bool Vector>
+static INLINE_ROW void divideRow(const int32_t* __restrict acc, Sample* __restrict out, int count,
+                                 int divisor, int maxColor) {
+    if (divisor == 1) {
+        SIMD_LOOP(Vector)
+        for (int i = 0; i < count; i++) out[i] = clampSample<Sample>(acc[i], maxColor, Absolute);
+        return;
+    }
+    int shift = 31;
+    while ((1u << (shift - 31)) < (unsigned)divisor) shift++;
+    uint32_t multiplier = static_cast<uint32_t>(((1ull << shift) + divisor - 1) / divisor);
+    SIMD_LOOP(Vector)
+    for (int i = 0; i < count; i++) {
+        uint32_t magnitude = static_cast<uint32_t>(acc[i] < 0 ? -acc[i] : acc[i]);
+        int quotient = static_cast<int>(((uint64_t)magnitude * multiplier) >> shift);
+        out[i] = clampSample<Sample>(acc[i] < 0 ? -quotient : quotient, maxColor, Absolute);
+    }
+}
+
+template <bool Vector, typename Sample>
+static INLINE_ROW void finishRow(const int32_t* acc, Sample* out, int count, const Kernel& kernel,
+                                 int maxColor, bool absolute) {
+    if (absolute) divideRow<Sample, true, Vector>(acc, out, count, kernel.getDivisor(), maxColor);
+    else divideRow<Sample, false, Vector>(acc, out, count, kernel.getDivisor(), maxColor);
+}
+
+template <bool Vector, typename Sample>
+static INLINE_ROW void kernelRows(const Kernel& kernel, const Sample* src, Sample* dst, int dstStride, int width,
+                                  int height, int channels, int maxColor, bool absolute, int y0, int y1, int x0, int x1) {
+    int size = kernel.getSize();
+    int radius = kernel.getRadius();
+    size_t rowLength = (size_t)width * channels;
+    int count = (x1 - x0) * channels;
+    std::vector<int32_t> acc(count);
+
+    if (!kernel.isSeparable()) {
+        for (int y = y0; y < y1; y++) {
+            std::fill(acc.begin(), acc.end(), 0);
+            for (int ky = 0; ky < size; ky++) {
+                int yy = y + ky - radius;
+                if (yy < 0 || yy >= height) continue;
+                kernelRow<Vector>(acc.data(), src + yy * rowLength, kernel.getRow(ky), size, width, channels, x0, x1);
+            }
+            finishRow<Vector>(acc.data(), dst + (size_t)(y - y0) * dstStride, count, kernel, maxColor, absolute);
+        }
+        return;
+    }
+
+    // Separable: la pasada horizontal de cada fila de entrada se guarda en un
+    // anillo de `size` filas y la vertical combina las que cubre el kernel.
+    // Asi cada fila de entrada se filtra en horizontal una sola vez.
+    std::vector<int32_t> ring((size_t)size * count);
+    const int* rowFactors = kernel.getRowFactors();
+    const int* columnFactors = kernel.getColumnFactors();
+    int next = std::max(0, y0 - radius);
+
+    for (int y = y0; y < y1; y++) {
+        for (; next <= std::min(height - 1, y + radius); next++) {
+            int32_t* slot = ring.data() + (size_t)(next % size) * count;
+            std::fill(slot, slot + count, 0);
+            kernelRow<Vector>(slot, src + next * rowLength, rowFactors, size, width, channels, x0, x1);
+        }
+
+        std::fill(acc.begin(), acc.end(), 0);
+        for (int ky = 0; ky < size; ky++) {
+            int yy = y + ky - radius;
+            if (yy < 0 || yy >= height || columnFactors[ky] == 0) continue;
+            accumulateRow<Vector>(acc.data(), ring.data() + (size_t)(yy % size) * count, columnFactors[ky], count);
+        }
+        finishRow<Vector>(acc.data(), dst + (size_t)(y - y0) * dstStride, count, kernel, maxColor, absolute);
+    }
+}
+
+ISA_VARIANTS(kernelRegionIsa,
+             (const Kernel& kernel, const Sample* src, Sample* dst, int dstStride, int width, int height,
+              int channels, int maxColor, bool absolute, int y0, int y1, int x0, int x1),
+             (kernelRows<Vector>(kernel, src, dst, dstStride, width, height, channels, maxColor, absolute,
+                                 y0, y1, x0, x1)),
+             typename Sample)
+
+template <typename Sample>
+static void kernelRegion(const Kernel& kernel, const Sample* src, Sample* dst, int dstStride, int width, int height,
+                         int channels, int maxColor, bool absolute, int y0, int y1, int x0, int x1) {
+    absolute = absolute || kernel.isAbsolute();
+    ISA_SELECT(kernelRegionIsa, Sample)(kernel, src, dst, dstStride, width, height, channels, maxColor, absolute,
+                                        y0, y1, x0, x1);
+}
+
+template <typename Sample>
+void applyFilterRegion(const Filter& filter, const Sample* src, Sample* dst, int dstStride, int width, int height,
+                       int channels, int maxColor, bool absolute, int y0, int y1, int x0, int x1) {
+    if (y0 >= y1 || x0 >= x1) return;
+
+    switch (filter.type) {
+        case FILTER_BLUR:
+            boxBlurRegion<1>(src, dst, dstStride, width, height, channels, maxColor, y0, y1, x0, x1);
+            break;
+        case FILTER_LAPLACE:
+            stencilRegion<LaplaceStencil>(src, dst, dstStride, width, height, channels, maxColor, absolute, y0, y1, x0, x1);
+            break;
+        case FILTER_SHARPEN:
+            stencilRegion<SharpenStencil>(src, dst, dstStride, width, height, channels, maxColor, absolute, y0, y1, x0, x1);
+            break;
+        case FILTER_KERNEL:
+            kernelRegion(filter.kernel, src, dst, dstStride, width, height, channels, maxColor, absolute, y0, y1, x0, x1);
+            break;
+    }
+}
+
+// blur, laplace y sharpening comparten el vecindario 3x3: con la cruz
+// (N + S + E + O) y las esquinas se obtienen los tres a la vez, ya que
+// laplace = cruz - 4c, sharpening = c - laplace y blur = (esquinas + cruz + c) / 9.
+template <typename Sample, bool Absolute, bool Vector>
+static INLINE_ROW void fusedTrioRow(const Sample* __restrict above, const Sample* __restrict row,
+                                    const Sample* __restrict below, Sample* __restrict blur,
+                                    Sample* __restrict laplace, Sample* __restrict sharpen,
+                                    int begin, int end, int step, int maxColor) {
+    SIMD_LOOP(Vector)
+    for (int i = begin; i < end; i++) {
+        int center = row[i];
+        int cross = above[i] + below[i] + row[i - step] + row[i + step];
+        int corners = above[i - step] + above[i + step] + below[i - step] + below[i + step];
+        int edges = cross - 4 * center;
+        uint32_t mean = static_cast<uint32_t>(corners + cross + center) / 9;
+        blur[i - begin] = static_cast<Sample>(std::min<uint32_t>(mean, maxColor));
+        laplace[i - begin] = clampSample<Sample>(edges, maxColor, Absolute);
+        sharpen[i - begin] = clampSample<Sample>(center - edges, maxColor, Absolute);
+    }
+}
+
+template <typename Sample, bool Absolute, bool Vector>
+static INLINE_ROW void fusedTrioRows(const Sample* src, Sample* blur, Sample* laplace, Sample* sharpen, int dstStride,
+                                     int width, int height, int channels, int maxColor, int y0, int y1) {
+    size_t rowLength = (size_t)width * channels;
+    std::vector<Sample> zeros;
+    if (y0 == 0 || y1 == height) zeros.assign(rowLength, 0);
+
+    int begin = channels;
+    int end = (width - 1) * channels;
+    for (int y = y0; y < y1; y++) {
+        const Sample* above = y > 0 ? src + (y - 1) * rowLength : zeros.data();
+        const Sample* row = src + y * rowLength;
+        const Sample* below = y < height - 1 ? src + (y + 1) * rowLength : zeros.data();
+        size_t offset = (size_t)(y - y0) * dstStride + begin;
+        fusedTrioRow<Sample, Absolute, Vector>(above, row, below, blur + offset, laplace + offset, sharpen + offset,
+                                       begin, end, channels, maxColor);
+    }
+}
+
+ISA_VARIANTS(fusedTrioIsa,
+             (const Sample* src, Sample* blur, Sample* laplace, Sample* sharpen, int dstStride, int width,
+              int height, int channels, int maxColor, int y0, int y1),
+             (fusedTrioRows<Sample, Absolute, Vector>(src, blur, laplace, sharpen, dstStride, width, height,
+                                                      channels, maxColor, y0, y1)),
+             typename Sample, bool Absolute)
+
+// indice de blur, laplace y sharpening en filters, o false si el conjunto no
+// es exactamente esos tres
+static bool findTrio(const Filter* filters, int count, int trio[3]) {
+    if (count != 3) return false;
+    trio[0] = trio[1] = trio[2] = -1;
+    for (int i = 0; i < count; i++) {
+        if (filters[i].type == FILTER_KERNEL || trio[filters[i].type] >= 0) return false;
+        trio[filters[i].type] = i;
+    }
+    return true;
+}
+
+template <typename Sample>
+void applyFiltersRegion(const Filter* filters, int count, const Sample* src, Sample* const* dsts, int dstStride,
+                        int width, int height, int channels, int maxColor, bool absolute, int y0, int y1) {
+    if (y0 >= y1) return;
+
+    int trio[3];
+    if (width >= 3 && findTrio(filters, count, trio)) {
+        Sample* blur = dsts[trio[FILTER_BLUR]];
+        Sample* laplace = dsts[trio[FILTER_LAPLACE]];
+        Sample* sharpen = dsts[trio[FILTER_SHARPEN]];
+        if (absolute) {
+            ISA_SELECT(fusedTrioIsa, Sample, true)(src, blur, laplace, sharpen, dstStride, width, height, channels,
+                                                   maxColor, y0, y1);
+        } else {
+            ISA_SELECT(fusedTrioIsa, Sample, false)(src, blur, laplace, sharpen, dstStride, width, height, channels,
+                                                    maxColor, y0, y1);
+        }
+
+        // la primera y la ultima columna, con sus taps recortados
+        for (int i = 0; i < count; i++) {
+            applyFilterRegion(filters[i], src, dsts[i], dstStride, width, height, channels, maxColor, absolute,
+                              y0, y1, 0, 1);
+            applyFilterRegion(filters[i], src, dsts[i] + (width - 1) * channels, dstStride, width, height, channels,
+                              maxColor, absolute, y0, y1, width - 1, width);
+        }
+        return;
+    }
+
+    // caso general: bandas de pocas filas para que la entrada siga en cache
+    // mientras pasan por ella todos los filtros
+    for (int band = y0; band < y1; band += FUSED_BAND_ROWS) {
+        int bandEnd = std::min(y1, band + FUSED_BAND_ROWS);
+        for (int i = 0; i < count; i++) {
+            applyFilterRegion(filters[i], src, dsts[i] + (size_t)(band - y0) * dstStride, dstStride, width, height,
+                              channels, maxColor, absolute, band, bandEnd, 0, width);
+        }
+    }
+}
+
+template void applyFilterRegion<uint8_t>(const Filter&, const uint8_t*, uint8_t*, int, int, int,
+                                         int, int, bool, int, int, int, int);
+template void applyFilterRegion<uint16_t>(const Filter&, const uint16_t*, uint16_t*, int, int, int,
+                                          int, int, bool, int, int, int, int);
+
+template void applyFiltersRegion<uint8_t>(const Filter*, int, const uint8_t*, uint8_t* const*, int,
+                                          int, int, int, int, bool, int, int);
+template void applyFiltersRegion<uint16_t>(const Filter*, int, const uint16_t*, uint16_t* const*, int,
+                                           int, int, int, int, bool, int, int);
+
+template <typename Sample>
+struct ChainState {
+    const Filter* filters;
+    int count;
+    Sample* buffers[2];
+    int width;
+    int height;
+    int channels;
+    int maxColor;
+    // filas ya terminadas por cada etapa
+    int done[MAX_FILTER_CHAIN];
+    pthread_mutex_t mutex;
+    pthread_cond_t progress;
+};
+
+template <typename Sample>
+struct ChainStage {
+    ChainState<Sample>* state;
+    int index;
+};
+
+// Fila (exclusiva) hasta la que puede llegar la etapa k. Necesita las filas
+// de la etapa anterior hasta y + su radio, y como escribe en el buffer que
+// esa etapa aun lee, no puede pisar las filas que le quedan por leer.
+template <typename Sample>
+static int chainLimit(const ChainState<Sample>& state, int k) {
+    if (k == 0 || state.done[k - 1] == state.height) return state.height;
+    int radius = std::max(filterRadius(state.filters[k]), filterRadius(state.filters[k - 1]));
+    return std::max(0, state.done[k - 1] - radius);
+}
+
+template <typename Sample>
+static void chainBand(const ChainState<Sample>& state, int k, int y0, int y1) {
+    TraceSpan span("filter band");
+    size_t rowLength = (size_t)state.width * state.channels;
+    applyFilterRegion(state.filters[k], state.buffers[k % 2], state.buffers[(k + 1) % 2] + y0 * rowLength,
+                      (int)rowLength, state.width, state.height, state.channels, state.maxColor, false,
+                      y0, y1, 0, state.width);
+}
+
+template <typename Sample>
+static void* chainWorker(void* arg) {
+    ChainStage<Sample>* stage = static_cast<ChainStage<Sample>*>(arg);
+    ChainState<Sample>& state = *stage->state;
+    int k = stage->index;
+
+    pthread_mutex_lock(&state.mutex);
+    while (state.done[k] < state.height) {
+        int limit = chainLimit(state, k);
+        if (limit <= state.done[k]) {
+            TraceSpan span("chain wait");
+            pthread_cond_wait(&state.progress, &state.mutex);
+            continue;
+        }
+        int y0 = state.done[k];
+        int y1 = std::min(limit, y0 + CHAIN_BAND_ROWS);
+        pthread_mutex_unlock(&state.mutex);
+
+        chainBand(state, k, y0, y1);
+
+        pthread_mutex_lock(&state.mutex);
+        state.done[k] = y1;
+        pthread_cond_broadcast(&state.progress);
+    }
+    pthread_mutex_unlock(&state.mutex);
+    return nullptr;
+}
+
+template <typename Sample>
+Sample* applyFilterChain(const Filter* filters, int count, Sample* pixels, Sample* spare, int width, int height,
+                         int channels, int maxColor, bool pipelined) {
+    count = std::min(count, MAX_FILTER_CHAIN);
+    if (count <= 0 || height <= 0 || width <= 0) return pixels;
+
+    ChainState<Sample> state;
+    state.filters = filters;
+    state.count = count;
+    state.buffers[0] = pixels;
+    state.buffers[1] = spare;
+    state.width = width;
+    state.height = height;
+    state.channels = channels;
+    state.maxColor = maxColor;
+    for (int k = 0; k < count; k++) state.done[k] = 0;
+
+    if (!pipelined || count == 1) {
+        // un solo hilo en frente de onda: una banda de cada etapa por vuelta,
+        // mientras las filas que comparten siguen en cache
+        while (state.done[count - 1] < height) {
+            for (int k = 0; k < count; k++) {
+                int y1 = std::min(chainLimit(state, k), state.done[k] + CHAIN_BAND_ROWS);
+                if (y1 <= state.done[k]) continue;
+                chainBand(state, k, state.done[k], y1);
+                state.done[k] = y1;
+            }
+        }
+        return state.buffers[count % 2];
+    }
+
+    pthread_mutex_init(&state.mutex, nullptr);
+    pthread_cond_init(&state.progress, nullptr);
+
+    ChainStage<Sample> stages[MAX_FILTER_CHAIN];
+    pthread_t threads[MAX_FILTER_CHAIN];
+    int started = 0;
+    for (int k = 0; k < count; k++) {
+        stages[k].state = &state;
+        stages[k].index = k;
+        if (pthread_create(&threads[k], nullptr, chainWorker<Sample>, &stages[k]) != 0) break;
+        started++;
+    }
+    // si no se pudo crear algun hilo, este hace las etapas que faltan
+    for (int k = started; k < count; k++) chainWorker<Sample>(&stages[k]);
+    for (int k = 0; k < started; k++) pthread_join(threads[k], nullptr);
+
+    pthread_cond_destroy(&state.progress);
+    pthread_mutex_destroy(&state.mutex);
+    return state.buffers[count % 2];
+}
+
+template uint8_t* applyFilterChain<uint8_t>(const Filter*, int, uint8_t*, uint8_t*, int, int, int, int, bool);
+template uint16_t* applyFilterChain<uint16_t>(const Filter*, int, uint16_t*, uint16_t*, int, int, int, int, bool);
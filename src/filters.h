@@ -0,0 +1,56 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <cstdint>
+#include "kernel.h"
+
+enum FilterType {
+    FILTER_BLUR,
+    FILTER_LAPLACE,
+    FILTER_SHARPEN,
+    FILTER_KERNEL
+};
+
+// blur, laplace y sharpening tienen una ruta especializada; el resto de
+// filtros son un Kernel NxN que se aplica con el motor general
+struct Filter {
+    FilterType type;
+    Kernel kernel;
+};
+
+bool parseFilter(const char* name, Filter* filter);
+bool loadFilterKernel(const char* path, Filter* filter);
+
+#define MAX_FILTER_CHAIN 16
+
+// "blur,sharpening,laplace" -> filtros en orden; devuelve cuantos o -1 si
+// algun nombre no es valido
+int parseFilterChain(const char* list, Filter* filters, int maxFilters);
+
+// filas de vecindario que necesita el filtro por encima y por debajo
+int filterRadius(const Filter& filter);
+
+// Aplica el filtro a la region [y0, y1) x [x0, x1) de src. dst
+// apunta a la muestra (y0, x0) de destino y dstStride es su numero de
+// muestras por fila. Con absolute se toma el valor absoluto antes de recortar.
+template <typename Sample>
+void applyFilterRegion(const Filter& filter, const Sample* src, Sample* dst, int dstStride, int width, int height,
+                       int channels, int maxColor, bool absolute, int y0, int y1, int x0, int x1);
+
+// Aplica varios filtros a las filas completas [y0, y1) en un solo barrido:
+// cada fila de entrada se lee una vez para todos los filtros. dsts[i] apunta
+// a la fila y0 de la salida del filtro i.
+template <typename Sample>
+void applyFiltersRegion(const Filter* filters, int count, const Sample* src, Sample* const* dsts, int dstStride,
+                        int width, int height, int channels, int maxColor, bool absolute, int y0, int y1);
+
+// Aplica los filtros uno tras otro usando solo dos buffers: la etapa k lee
+// buffers[k % 2] y escribe en el otro. pixels es la entrada y spare el
+// segundo buffer; devuelve el que contiene el resultado. Las etapas avanzan
+// por bandas de filas y cada una empieza en cuanto la anterior ha terminado
+// las filas que necesita; con pipelined cada etapa corre en su propio hilo.
+template <typename Sample>
+Sample* applyFilterChain(const Filter* filters, int count, Sample* pixels, Sample* spare, int width, int height,
+                         int channels, int maxColor, bool pipelined);
+
+#endif
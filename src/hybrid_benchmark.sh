@@ -0,0 +1,41 @@
+#!/bin/bash
+# Compara, con el mismo numero total de nucleos, solo hilos (pth_filterer y
+# un rank con N hilos), solo MPI (N ranks de un hilo) y las mezclas R x N/R.
+# Uso: ./hybrid_benchmark.sh [imagen] [nucleos]   (desde la raiz del repositorio)
+# MPIRUN permite pasar opciones extra, p.ej. MPIRUN="mpirun --bind-to core"
+# REPEATS repeticiones por configuracion; se muestra la mediana.
+
+IMAGE=${1:-images/damma.pgm}
+CORES=${2:-$(nproc)}
+REPEATS=${REPEATS:-3}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-.}
+EXT=${IMAGE##*.}
+OUT=$(mktemp -d)
+OUTPUTS="$OUT/blur.$EXT $OUT/laplace.$EXT $OUT/sharpen.$EXT"
+
+# mediana del "Total Execution Time" de REPEATS ejecuciones de un comando
+median() {
+  for i in $(seq $REPEATS); do
+    "$@" | grep "^Total Execution Time" | awk '{print $(NF-1)}'
+  done | sort -g | awk '{t[NR] = $1} END {print t[int((NR + 1) / 2)]}'
+}
+
+report() {
+  printf "%-28s %10.4f %8.2f\n" "$1" $2 $(awk "BEGIN {print $base / $2}")
+}
+
+printf "%-28s %10s %8s\n" configuration "time (s)" speedup
+base=$(median $MPIRUN -np 1 $BIN/mpi_filterer "$IMAGE" $OUTPUTS)
+report "serial (1 rank x 1 thread)" $base
+
+report "pth_filterer $CORES threads" \
+  $(median $BIN/pth_filterer "$IMAGE" $OUTPUTS --f blur,laplace,sharpening --threads $CORES)
+for ranks in $(seq $CORES); do
+  [ $((CORES % ranks)) -ne 0 ] && continue
+  threads=$((CORES / ranks))
+  report "$ranks ranks x $threads threads" \
+    $(median $MPIRUN -np $ranks $BIN/mpi_filterer "$IMAGE" $OUTPUTS --threads $threads)
+done
+
+rm -rf $OUT
@@ -1,18 +1,48 @@
 #include "image.h"
 #include "pgmimage.h"
 #include "ppmimage.h"
+#include "netpbm.h"
+#include "filters.h"
 #include <cstring>
+#include <cstdint>
+
+Image* Image::create(const char* magic, int maxColor) {
+    bool wide = netpbmSampleBytes(maxColor) == 2;
+
+    if (strcmp(magic, "P2") == 0 || strcmp(magic, "P5") == 0) {
+        if (wide) return new PGMImage<uint16_t>();
+        return new PGMImage<uint8_t>();
+    }
+    if (strcmp(magic, "P3") == 0 || strcmp(magic, "P6") == 0) {
+        if (wide) return new PPMImage<uint16_t>();
+        return new PPMImage<uint8_t>();
+    }
+
+    return nullptr;
+}
 
 Image* Image::createFromFile(const char* filename) {
     FILE* file = fopen(filename, "r");
     if (!file) return nullptr;
-    
-    char magic[3];
-    fscanf(file, "%2s", magic);
+
+    // el tipo de muestra depende de maxColor, asi que hay que leer la cabecera completa
+    MappedFile mapping;
+    NetpbmHeader header;
+    bool ok = mapping.map(file) && parseNetpbmHeader(mapping.getData(), mapping.getSize(), &header);
     fclose(file);
-    
-    if (strcmp(magic, "P2") == 0) return new PGMImage();
-    if (strcmp(magic, "P3") == 0) return new PPMImage();
-    
-    return nullptr;
-}
\ No newline at end of file
+    if (!ok) return nullptr;
+
+    return create(header.magicNumber, header.maxColor);
+}
+
+void Image::setBinary(bool binary) {
+    if (magicNumber[1] == '2' || magicNumber[1] == '5') magicNumber[1] = binary ? '5' : '2';
+    else if (magicNumber[1] == '3' || magicNumber[1] == '6') magicNumber[1] = binary ? '6' : '3';
+}
+
+bool Image::applyFilter(const char* filterType) {
+    Filter filter;
+    if (!parseFilter(filterType, &filter)) return false;
+    applyFilter(filter);
+    return true;
+}
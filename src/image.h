@@ -2,27 +2,64 @@
 #define IMAGE_H
 
 #include <cstdio>
+#include <cstddef>
+
+struct Filter;
 
 class Image {
     protected:
-        char magicNumber[3];  
+        char magicNumber[3];
         int width;
         int height;
         int maxColor;
-        
+        // MB/s del parseo de texto del ultimo load
+        double parseThroughput = 0.0;
+
     public:
         virtual ~Image() = default;
-        virtual void load(FILE* input) = 0;
-        virtual void save(FILE* output) = 0;
-        virtual void applyFilter(const char* filterType) = 0;
-        virtual void loadFromData(const char* magic, int width, int height, int maxColor, int* pixels) = 0;
-        
-        static Image* createFromFile(const char* filename); 
-        
+        // false si el archivo no es una imagen de este tipo o su raster
+        // binario esta truncado; en texto las muestras que falten quedan a cero
+        virtual bool load(FILE* input) = 0;
+        // false si no se pudo escribir todo (disco lleno, pipe cerrado...)
+        virtual bool save(FILE* output) = 0;
+        // Copia a memoria propia los pixeles que aun son las paginas mapeadas
+        // del archivo de entrada. Se llama antes de abrir la salida, que puede
+        // ser el mismo archivo: al truncarlo las paginas mapeadas se pierden.
+        virtual void detachInput() = 0;
+        virtual void applyFilter(const Filter& filter) = 0;
+        // region [startY, endY) x [startX, endX) del filtro en output, del mismo tipo y tamano
+        virtual void applyFilterToRegion(const Filter& filter, Image* output, int startY, int endY, int startX, int endX) = 0;
+        // filas [startY, endY) de cada filtro en outputs[i], que debe tener el mismo tipo y tamano
+        virtual void applyFiltersToRegion(const Filter* filters, int count, Image* const* outputs, int startY, int endY) = 0;
+        // filtros encadenados sobre dos buffers; con pipelined una etapa por hilo
+        virtual void applyFilterChain(const Filter* filters, int count, bool pipelined) = 0;
+        // la misma cadena pasando a teselas de 64x64 y volviendo a filas al final
+        virtual void applyFilterChainTiled(const Filter* filters, int count) = 0;
+        // la misma cadena con un plano contiguo por canal; con parallel un hilo por canal
+        virtual void applyFilterChainPlanar(const Filter* filters, int count, bool parallel) = 0;
+        bool applyFilter(const char* filterType);
+        virtual void loadFromData(const char* magic, int width, int height, int maxColor, const void* pixels) = 0;
+        virtual void allocate(const char* magic, int width, int height, int maxColor) = 0;
+        // usa pixels sin copiarlos ni liberarlos (p.ej. memoria compartida entre procesos)
+        virtual void attach(const char* magic, int width, int height, int maxColor, void* pixels) = 0;
+
+        virtual int getChannels() const = 0;
+        virtual int getSampleSize() const = 0;
+        virtual void* getRawPixels() = 0;
+
+        static Image* create(const char* magic, int maxColor);
+        static Image* createFromFile(const char* filename);
+
         int getWidth() const { return width; }
         int getHeight() const { return height; }
         int getMaxColor() const { return maxColor; }
         const char* getMagicNumber() const { return magicNumber; }
+        size_t getSampleCount() const { return (size_t)width * height * getChannels(); }
+        size_t getDataSize() const { return getSampleCount() * getSampleSize(); }
+        bool isBinary() const { return magicNumber[1] == '5' || magicNumber[1] == '6'; }
+        // 0 si la imagen no se leyo de texto
+        double getParseThroughput() const { return parseThroughput; }
+        void setBinary(bool binary);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,184 @@
+#include "kernel.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// limite de sum(|peso|) para que la suma de muestras de 16 bits quepa en un int
+#define MAX_KERNEL_MAGNITUDE 32767
+#define KERNEL_LINE 4096
+
+static const int GAUSSIAN5[5] = {1, 4, 6, 4, 1};
+static const int GAUSSIAN7[7] = {1, 6, 15, 20, 15, 6, 1};
+static const int SOBEL_SMOOTH[3] = {1, 2, 1};
+static const int SOBEL_DERIVATIVE[3] = {-1, 0, 1};
+
+static void outerProduct(const int* column, const int* row, int size, int* weights) {
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) weights[y * size + x] = column[y] * row[x];
+    }
+}
+
+static int gcd(int a, int b) {
+    a = std::abs(a);
+    b = std::abs(b);
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+Kernel::Kernel() : size(1), divisor(1), absolute(false), separable(true) {
+    weights[0] = 1;
+    rowFactors[0] = 1;
+    columnFactors[0] = 1;
+}
+
+bool Kernel::set(int newSize, const int* newWeights, int newDivisor, bool newAbsolute) {
+    if (newSize < 1 || newSize > MAX_KERNEL_SIZE || newSize % 2 == 0 || newDivisor == 0) return false;
+
+    long magnitude = 0;
+    for (int i = 0; i < newSize * newSize; i++) magnitude += std::abs((long)newWeights[i]);
+    if (magnitude > MAX_KERNEL_MAGNITUDE) return false;
+
+    // la division trunca hacia cero, asi que cambiar el signo de pesos y
+    // divisor a la vez no altera el resultado
+    int sign = newDivisor < 0 ? -1 : 1;
+    size = newSize;
+    for (int i = 0; i < size * size; i++) weights[i] = sign * newWeights[i];
+    divisor = sign * newDivisor;
+    absolute = newAbsolute;
+    detectSeparable();
+    return true;
+}
+
+// Un kernel entero es separable si tiene rango 1: todas las filas no nulas
+// son multiplos enteros de una misma fila primitiva. Los factores reproducen
+// exactamente los pesos, asi que las dos pasadas 1D dan las mismas sumas.
+void Kernel::detectSeparable() {
+    separable = false;
+
+    int base = -1;
+    for (int i = 0; i < size * size && base < 0; i++) {
+        if (weights[i] != 0) base = i / size;
+    }
+    if (base < 0) return;
+
+    const int* row = weights + base * size;
+    int common = 0;
+    int lead = -1;
+    for (int x = 0; x < size; x++) {
+        common = gcd(common, row[x]);
+        if (lead < 0 && row[x] != 0) lead = x;
+    }
+    if (row[lead] < 0) common = -common;
+    for (int x = 0; x < size; x++) rowFactors[x] = row[x] / common;
+
+    for (int y = 0; y < size; y++) {
+        const int* current = weights + y * size;
+        if (current[lead] % rowFactors[lead] != 0) return;
+        int factor = current[lead] / rowFactors[lead];
+        for (int x = 0; x < size; x++) {
+            if (current[x] != factor * rowFactors[x]) return;
+        }
+        columnFactors[y] = factor;
+    }
+    separable = true;
+}
+
+bool Kernel::builtin(const char* name, Kernel* kernel) {
+    int weights[MAX_KERNEL_SIZE * MAX_KERNEL_SIZE];
+
+    if (strcmp(name, "gaussian5") == 0) {
+        outerProduct(GAUSSIAN5, GAUSSIAN5, 5, weights);
+        return kernel->set(5, weights, 256, false);
+    }
+    if (strcmp(name, "gaussian7") == 0) {
+        outerProduct(GAUSSIAN7, GAUSSIAN7, 7, weights);
+        return kernel->set(7, weights, 4096, false);
+    }
+    if (strcmp(name, "sobelx") == 0) {
+        outerProduct(SOBEL_SMOOTH, SOBEL_DERIVATIVE, 3, weights);
+        return kernel->set(3, weights, 1, true);
+    }
+    if (strcmp(name, "sobely") == 0) {
+        outerProduct(SOBEL_DERIVATIVE, SOBEL_SMOOTH, 3, weights);
+        return kernel->set(3, weights, 1, true);
+    }
+    if (strcmp(name, "unsharp") == 0) {
+        // 2 * original - gaussiana 5x5
+        outerProduct(GAUSSIAN5, GAUSSIAN5, 5, weights);
+        for (int i = 0; i < 25; i++) weights[i] = -weights[i];
+        weights[12] += 2 * 256;
+        return kernel->set(5, weights, 256, false);
+    }
+    return false;
+}
+
+// Formato de un archivo .k: '#' inicia un comentario; "size N", "divisor D"
+// y "abs" son opcionales; el resto son los N*N pesos fila a fila. Sin
+// divisor se divide por la suma de los pesos (o por 1 si suman cero).
+bool Kernel::loadFromFile(const char* path, Kernel* kernel) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    double values[MAX_KERNEL_SIZE * MAX_KERNEL_SIZE];
+    int count = 0;
+    int declaredSize = 0;
+    double declaredDivisor = 0;
+    bool hasDivisor = false;
+    bool isAbsolute = false;
+    bool ok = true;
+
+    char line[KERNEL_LINE];
+    while (ok && fgets(line, sizeof(line), file)) {
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        for (char* token = strtok(line, " \t\r\n,"); token && ok; token = strtok(nullptr, " \t\r\n,")) {
+            if (strcmp(token, "abs") == 0) {
+                isAbsolute = true;
+            } else if (strcmp(token, "size") == 0 || strcmp(token, "divisor") == 0) {
+                char* value = strtok(nullptr, " \t\r\n,");
+                char* end = nullptr;
+                double number = value ? strtod(value, &end) : 0;
+                if (!value || *end != '\0') ok = false;
+                else if (token[0] == 's') declaredSize = (int)number;
+                else { declaredDivisor = number; hasDivisor = true; }
+            } else {
+                char* end = nullptr;
+                double number = strtod(token, &end);
+                if (*end != '\0' || count == MAX_KERNEL_SIZE * MAX_KERNEL_SIZE) ok = false;
+                else values[count++] = number;
+            }
+        }
+    }
+    fclose(file);
+    if (!ok || count == 0) return false;
+
+    int newSize = declaredSize;
+    if (newSize == 0) newSize = (int)std::lround(std::sqrt((double)count));
+    if (newSize * newSize != count) return false;
+
+    // con pesos o divisor decimales se pasa todo a punto fijo
+    bool fractional = hasDivisor && declaredDivisor != std::floor(declaredDivisor);
+    for (int i = 0; i < count; i++) fractional = fractional || values[i] != std::floor(values[i]);
+    double scale = fractional ? KERNEL_FIXED_SCALE : 1;
+
+    int weights[MAX_KERNEL_SIZE * MAX_KERNEL_SIZE];
+    long sum = 0;
+    for (int i = 0; i < count; i++) {
+        if (std::fabs(values[i] * scale) > MAX_KERNEL_MAGNITUDE) return false;
+        weights[i] = (int)std::lround(values[i] * scale);
+        sum += weights[i];
+    }
+
+    long newDivisor;
+    if (hasDivisor) newDivisor = std::lround(declaredDivisor * scale);
+    else newDivisor = sum != 0 ? sum : (long)scale;
+    if (newDivisor == 0 || std::labs(newDivisor) > MAX_KERNEL_MAGNITUDE * (long)KERNEL_FIXED_SCALE) return false;
+
+    return kernel->set(newSize, weights, (int)newDivisor, isAbsolute);
+}
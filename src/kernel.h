@@ -0,0 +1,44 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#define MAX_KERNEL_SIZE 15
+#define KERNEL_FIXED_SCALE 4096
+
+// Kernel NxN (N impar) de pesos enteros. El resultado de cada pixel es
+// suma / divisor truncado hacia cero; con absolute se toma su valor absoluto
+// antes de recortarlo a [0, maxColor]. Los pesos decimales se guardan en
+// punto fijo multiplicando pesos y divisor por KERNEL_FIXED_SCALE.
+class Kernel {
+private:
+    int size;
+    int weights[MAX_KERNEL_SIZE * MAX_KERNEL_SIZE];
+    int divisor;
+    bool absolute;
+
+    // si el kernel es separable: weights[y][x] == columnFactors[y] * rowFactors[x]
+    bool separable;
+    int rowFactors[MAX_KERNEL_SIZE];
+    int columnFactors[MAX_KERNEL_SIZE];
+
+    void detectSeparable();
+
+public:
+    Kernel();
+
+    bool set(int size, const int* weights, int divisor, bool absolute);
+
+    static bool builtin(const char* name, Kernel* kernel);
+    static bool loadFromFile(const char* path, Kernel* kernel);
+
+    int getSize() const { return size; }
+    int getRadius() const { return size / 2; }
+    int getWeight(int y, int x) const { return weights[y * size + x]; }
+    const int* getRow(int y) const { return weights + y * size; }
+    int getDivisor() const { return divisor; }
+    bool isAbsolute() const { return absolute; }
+    bool isSeparable() const { return separable; }
+    const int* getRowFactors() const { return rowFactors; }
+    const int* getColumnFactors() const { return columnFactors; }
+};
+
+#endif
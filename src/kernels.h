@@ -0,0 +1,64 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <utility>
+
+// Un tap con peso conocido en compilacion: los ceros no leen memoria y los
+// pesos +-1 no multiplican.
+template <int Weight, typename Sample>
+inline int stencilTap(const Sample* p) {
+    if constexpr (Weight == 0) return 0;
+    else if constexpr (Weight == 1) return *p;
+    else if constexpr (Weight == -1) return -static_cast<int>(*p);
+    else return Weight * static_cast<int>(*p);
+}
+
+// Kernel 3x3 de enteros fijado en compilacion (pesos en orden fila a fila).
+// above, row y below son las tres filas del vecindario y step la distancia
+// entre pixeles vecinos dentro de la fila.
+template <int... Weights>
+struct Stencil3x3 {
+    static_assert(sizeof...(Weights) == 9, "a 3x3 stencil needs 9 weights");
+
+    static constexpr int weights[9] = {Weights...};
+
+    template <typename Sample>
+    static inline int apply(const Sample* __restrict above, const Sample* __restrict row,
+                            const Sample* __restrict below, int i, int step) {
+        return sum(above, row, below, i, step, std::make_index_sequence<9>());
+    }
+
+    // version para la primera y ultima columna, sin los taps que caen fuera
+    template <typename Sample>
+    static inline int applyClipped(const Sample* above, const Sample* row, const Sample* below,
+                                   int i, int step, bool hasLeft, bool hasRight) {
+        const Sample* rows[3] = {above, row, below};
+        int total = 0;
+        for (int tap = 0; tap < 9; tap++) {
+            int dx = tap % 3 - 1;
+            if ((dx < 0 && !hasLeft) || (dx > 0 && !hasRight) || weights[tap] == 0) continue;
+            total += weights[tap] * rows[tap / 3][i + dx * step];
+        }
+        return total;
+    }
+
+private:
+    template <size_t Tap, typename Sample>
+    static inline const Sample* tapRow(const Sample* above, const Sample* row, const Sample* below) {
+        if constexpr (Tap / 3 == 0) return above;
+        else if constexpr (Tap / 3 == 1) return row;
+        else return below;
+    }
+
+    template <typename Sample, size_t... Tap>
+    static inline int sum(const Sample* __restrict above, const Sample* __restrict row,
+                          const Sample* __restrict below, int i, int step, std::index_sequence<Tap...>) {
+        return (0 + ... + stencilTap<weights[Tap]>(tapRow<Tap>(above, row, below) + i + ((int)(Tap % 3) - 1) * step));
+    }
+};
+
+typedef Stencil3x3<0, 1, 0, 1, -4, 1, 0, 1, 0> LaplaceStencil;
+typedef Stencil3x3<0, -1, 0, -1, 5, -1, 0, -1, 0> SharpenStencil;
+
+#endif
@@ -1,191 +1,589 @@
 #include <iostream>
+#include <cstdio>
 #include <cstring>
+#include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <algorithm>
+#include <vector>
 #include <mpi.h>
 #include "image.h"
 #include "pgmimage.h"
 #include "ppmimage.h"
+#include "netpbm.h"
+#include "filters.h"
+#include "threadpool.h"
+#include "backend.h"
+#include "cli.h"
+#include "trace.h"
 
-#define TAG_WORK 1
-#define TAG_RESULT 2
+// cada etapa usa su propio par de tags para el halo
+#define TAG_HALO_UP(stage) (2 * (stage))
+#define TAG_HALO_DOWN(stage) (2 * (stage) + 1)
+
+#define CHUNKS_PER_THREAD 4
 
 #define MAX_FILENAME 256
 #define BUFFER_SIZE 1024
 
+// Banda que reparte el paso de mensajes: la de un rank o, con --shared, la
+// de un nodo entero. Las filas propias empiezan en haloTop; up y down son
+// los vecinos en comm (MPI_PROC_NULL en los bordes de la imagen). comm es
+// MPI_COMM_NULL en los ranks que no pasan mensajes.
+struct Band {
+  MPI_Comm comm;
+  int up;
+  int down;
+  int haloTop;
+  int rows;
+  int rowBytes;
+  MPI_Datatype rowType;
+};
+
+// Ranks que comparten los buffers de una banda. Sin --shared cada rank es
+// su propio nodo; con --shared los ranks de un mismo host se reparten las
+// filas de la banda del nodo y solo el rank 0 del nodo pasa mensajes.
+struct Node {
+  bool shared;
+  MPI_Comm comm;
+  int rank;
+  int size;
+  std::vector<MPI_Win> windows;
+};
+
+// Una etapa lee de src y escribe en dsts. Sin cadena hay una sola etapa con
+// todos los filtros; en una cadena cada filtro es una etapa y su salida es
+// la entrada de la siguiente.
+struct Stage {
+  const Filter* filters;
+  int count;
+  Image* src;
+  Image** dsts;
+  int halo;
+};
+
+static unsigned char* bandRow(Image* image, const Band& band, int row) {
+  return static_cast<unsigned char*>(image->getRawPixels()) + (long)row * band.rowBytes;
+}
+
+// Buffer de la banda: privado o, con --shared, una ventana del nodo que
+// reserva su rank 0 y los demas usan directamente.
+static Image* bandImage(const char* magic, int width, int rows, int maxColor, const Band& band, Node& node) {
+  Image* image = Image::create(magic, maxColor);
+  if (!node.shared) {
+    image->allocate(magic, width, rows, maxColor);
+    return image;
+  }
+
+  MPI_Aint bytes = node.rank == 0 ? (MPI_Aint)rows * band.rowBytes : 0;
+  void* base;
+  MPI_Win window;
+  MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node.comm, &base, &window);
+  int unit;
+  MPI_Win_shared_query(window, 0, &bytes, &unit, &base);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+  node.windows.push_back(window);
+  image->attach(magic, width, rows, maxColor, base);
+  return image;
+}
+
+// Hace visibles a todo el nodo las escrituras en las ventanas compartidas.
+static void nodeSync(Node& node) {
+  if (!node.shared) return;
+  for (MPI_Win window : node.windows) MPI_Win_sync(window);
+  MPI_Barrier(node.comm);
+  for (MPI_Win window : node.windows) MPI_Win_sync(window);
+}
+
+// Envia las primeras y ultimas `halo` filas propias a los vecinos y recibe
+// las suyas en las filas de halo, sin esperar a que terminen.
+static void postHalo(Image* image, const Band& band, int halo, int stage, MPI_Request* requests) {
+  if (band.comm == MPI_COMM_NULL) return;
+  int top = band.up != MPI_PROC_NULL ? halo : 0;
+  int bottom = band.down != MPI_PROC_NULL ? halo : 0;
+  int first = band.haloTop;
+  int last = band.haloTop + band.rows;
+  MPI_Irecv(bandRow(image, band, first - top), top, band.rowType, band.up, TAG_HALO_DOWN(stage), band.comm, &requests[0]);
+  MPI_Irecv(bandRow(image, band, last), bottom, band.rowType, band.down, TAG_HALO_UP(stage), band.comm, &requests[1]);
+  MPI_Isend(bandRow(image, band, first), top, band.rowType, band.up, TAG_HALO_UP(stage), band.comm, &requests[2]);
+  MPI_Isend(bandRow(image, band, last - bottom), bottom, band.rowType, band.down, TAG_HALO_DOWN(stage), band.comm, &requests[3]);
+}
+
+// Lee con MPI-IO las filas [firstRow, firstRow + count) del raster binario,
+// halo incluido, en el buffer de la banda local.
+static bool readRows(const char* path, MPI_Offset dataOffset, Image* local, const Band& band, int firstRow, int count) {
+  TraceSpan span("load");
+  MPI_File file;
+  if (MPI_File_open(band.comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) return false;
+  MPI_Offset offset = dataOffset + (MPI_Offset)firstRow * band.rowBytes;
+  int result = MPI_File_read_at_all(file, offset, local->getRawPixels(), count, band.rowType, MPI_STATUS_IGNORE);
+  MPI_File_close(&file);
+
+  if (local->getSampleSize() == 2) {
+    // big-endian en el archivo; cada muestra se decodifica sobre si misma
+    size_t samples = (size_t)count * band.rowBytes / 2;
+    decodeBinarySamples(static_cast<const unsigned char*>(local->getRawPixels()),
+                        static_cast<uint16_t*>(local->getRawPixels()), samples);
+  }
+  return result == MPI_SUCCESS;
+}
+
+// Cada rank escribe sus filas en su desplazamiento del archivo de salida;
+// solo el rank 0 escribe la cabecera.
+static bool writeRows(const char* path, const char* headerText, Image* source, const Band& band, int startY, int height) {
+  TraceSpan span("save");
+  MPI_File file;
+  if (MPI_File_open(band.comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) return false;
+  int headerLength = (int)strlen(headerText);
+  // un archivo anterior mas largo dejaria bytes sobrantes al final
+  MPI_File_set_size(file, headerLength + (MPI_Offset)height * band.rowBytes);
+
+  int rank;
+  MPI_Comm_rank(band.comm, &rank);
+  if (rank == 0) MPI_File_write_at(file, 0, headerText, headerLength, MPI_CHAR, MPI_STATUS_IGNORE);
+
+  const unsigned char* rows = bandRow(source, band, band.haloTop);
+  std::vector<unsigned char> encoded;
+  if (source->getSampleSize() == 2) {
+    size_t samples = (size_t)band.rows * band.rowBytes / 2;
+    encoded.resize(samples * 2);
+    encodeBinarySamples(reinterpret_cast<const uint16_t*>(rows), encoded.data(), samples);
+    rows = encoded.data();
+  }
+  MPI_Offset offset = headerLength + (MPI_Offset)startY * band.rowBytes;
+  int result = MPI_File_write_at_all(file, offset, rows, band.rows, band.rowType, MPI_STATUS_IGNORE);
+  MPI_File_close(&file);
+  return result == MPI_SUCCESS;
+}
+
+// Libera la banda local y sus resultados, las ventanas compartidas, el tipo
+// de fila y los comunicadores; igual al terminar que si falla la lectura.
+static void releaseBand(Band& band, Node& node, Image* local, const std::vector<Image*>& results) {
+  MPI_Type_free(&band.rowType);
+  for (Image* result : results) {
+    if (result != local) delete result;
+  }
+  delete local;
+  for (MPI_Win& window : node.windows) {
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+  }
+  if (node.shared && band.comm != MPI_COMM_NULL) MPI_Comm_free(&band.comm);
+  MPI_Comm_free(&node.comm);
+}
+
+// true si la operacion salio bien en todos los ranks
+static bool allRanks(bool ok) {
+  int local = ok ? 1 : 0, all = 0;
+  MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  return all == 1;
+}
+
+// Filas que reparte el pool de hilos de un rank: cada tarea es un trozo
+// contiguo de [startY, startY + rows).
+struct RowJob {
+  const Stage* stage;
+  int startY;
+  int rows;
+  int chunks;
+};
+
+static void filterChunk(void* context, int chunk) {
+  RowJob* job = (RowJob*)context;
+  TraceSpan span("filter band");
+  int first, last;
+  splitRows(chunk, job->chunks, job->rows, &first, &last);
+  if (first < last) {
+    job->stage->src->applyFiltersToRegion(job->stage->filters, job->stage->count, job->stage->dsts,
+                                          job->startY + first, job->startY + last);
+  }
+}
+
+// La parte de las filas [startY, endY) que calcula este rank del nodo,
+// repartida entre los hilos del pool. Solo el hilo principal llama a MPI.
+static void filterRows(const Stage& stage, const Node& node, ThreadPool& pool, int startY, int endY) {
+  int first, last;
+  splitRows(node.rank, node.size, endY - startY, &first, &last);
+  if (first >= last) return;
+  RowJob job = {&stage, startY + first, last - first, std::min(last - first, pool.getThreads() * CHUNKS_PER_THREAD)};
+  pool.run(job.chunks, filterChunk, &job);
+}
+
+// segundos acumulados por fase en cada rank; rank 0 imprime el maximo
+enum Phase { PHASE_READ, PHASE_HALO, PHASE_FILTER, PHASE_WRITE, PHASE_OVERLAP, PHASE_COUNT };
+static const char* PHASE_NAMES[PHASE_WRITE + 1] = {"Read", "Halo wait", "Filter", "Write"};
+
 int main(int argc, char* argv[]) {
-  MPI_Init(&argc, &argv);
+  // --backend: el mismo programa con cualquier estrategia de ejecucion
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--backend") == 0) return backendMain(argc, argv, NULL, NULL);
+  }
+
+  // los hilos de cada rank solo calculan; MPI se llama desde el hilo principal
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
   int rank, size;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-  if(size<4){
+  if(argc<5){
     if(rank == 0)
     {
-      std::cout << "There needs to be 4 processes." << std::endl;
+      std::cout << "Missing input and output paths\n";
+      std::cout << "Usage:" << argv[0] << " input_image.pgm output_blur.pgm output_laplace.pgm output_sharpening.pgm [--blocking] [--shared] [--threads N]" << std::endl;
+      std::cout << "or "<< argv[0] << "input_image.ppm output1.ppm [output2.ppm ...] --f filter1[,filter2...] | --kernel file.k" << std::endl;
+      std::cout << "or "<< argv[0] << "input_image.ppm output.ppm --f filter1,filter2[,...]  (chain)" << std::endl;
+      std::cout << "Options: --trace trace.json (rank r > 0 writes trace.json.rankr)" << std::endl;
+      std::cout << "or "<< argv[0] << " input_image output_image --f filters --backend " << availableBackends() << " [--threads N]" << std::endl;
     }
-    
-    std::cout << "Usage:" << argv[0] << " input_image.pgm output_blur.pgm output_laplace.pgm output_sharpening.pgm" << std::endl;
-    std::cout << "or "<< argv[0] << "input_image.ppm output_blur.ppm output_laplace.ppm output_sharpening.ppm" << std::endl;
     MPI_Finalize();
     return 1;
   }
 
-  
   double start_time = MPI_Wtime();
   double cpu_start = clock();
+  auto wall_start = std::chrono::high_resolution_clock::now();
 
-  if (rank == 0) {
-    auto wall_start = std::chrono::high_resolution_clock::now();
+  int outputCount = countOutputPaths(argc, argv);
+  char** outputPaths = argv + 2;
+  const char* defaultFilters = "blur,laplace,sharpening";
+  const char* filterList = defaultFilters;
+  const char* kernelFile = NULL;
+  const char* tracePath = NULL;
+  bool blocking = false;
+  int threads = 1;
+  Node node;
+  node.shared = false;
+  for (int i = 2 + outputCount; i < argc; i++) {
+    if (strcmp(argv[i], "--f") == 0 && i + 1 < argc) filterList = argv[++i];
+    else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) kernelFile = argv[++i];
+    else if (strcmp(argv[i], "--blocking") == 0) blocking = true;
+    else if (strcmp(argv[i], "--shared") == 0) node.shared = true;
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+  }
+  if (threads <= 0) {
+    if (rank == 0) std::cout << "Error, --threads must be a positive number" << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+  if (threads > 1 && provided < MPI_THREAD_FUNNELED) {
+    if (rank == 0) std::cout << "Warning, the MPI library does not support MPI_THREAD_FUNNELED, using one thread per rank" << std::endl;
+    threads = 1;
+  }
 
-    Image* image = Image::createFromFile(argv[1]);
-    if (image == NULL) {
+  // con una salida por filtro todos se aplican a la entrada; con una sola
+  // salida y varios filtros se encadenan
+  Filter filters[MAX_FILTER_CHAIN];
+  if (filterList == defaultFilters && kernelFile == NULL && outputCount != 3) {
+    if (rank == 0) std::cout << "Error, without --f or --kernel give three outputs (blur, laplace and sharpening)" << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+  // todos los ranks leen los filtros; solo el 0 informa del error
+  int filterCount = parseFilterOptions(filterList, kernelFile, filters, rank == 0);
+  if (filterCount < 0) {
+    MPI_Finalize();
+    return 1;
+  }
+  bool chain = outputCount == 1 && filterCount > 1;
+  if (filterCount != outputCount && !chain) {
+    if (rank == 0) std::cout << "Error, give one output path or one per filter" << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+  int halo = 0;
+  for (int i = 0; i < filterCount; i++) halo = std::max(halo, filterRadius(filters[i]));
+
+  // cada rank traza sus hilos en su propio archivo
+  if (tracePath != NULL) traceStart(rank);
+
+  Image* image = NULL;
+  double parseThroughput = 0.0;
+  double phases[PHASE_COUNT] = {0.0, 0.0, 0.0, 0.0, 0.0};
+  double phaseStart = MPI_Wtime();
+
+  // Rank 0 solo lee la cabecera. Las imagenes P5/P6 completas las lee cada
+  // rank por su cuenta con MPI-IO; las de texto las carga rank 0 y las
+  // reparte. Una binaria truncada va tambien a load, que la rechaza.
+  // width, height, maxColor, inicio del raster, lectura paralela; width < 0 si hubo error
+  long long header[5] = {-1, 0, 0, 0, 0};
+  char magic[3] = "";
+
+  if (rank == 0) {
+    FILE *file = fopen(argv[1], "r");
+    MappedFile mapping;
+    NetpbmHeader fileHeader;
+    if (file == NULL || !mapping.map(file) || !parseNetpbmHeader(mapping.getData(), mapping.getSize(), &fileHeader)) {
       std::cout << "Error, incorrect path or incorrect file." << std::endl;
-      MPI_Finalize();
-      return 1;
+    } else {
+      strcpy(magic, fileHeader.magicNumber);
+      size_t bytes = (size_t)fileHeader.width * fileHeader.height * netpbmChannels(magic) * netpbmSampleBytes(fileHeader.maxColor);
+      bool parallelRead = isBinaryMagic(magic) && mapping.getSize() - fileHeader.dataOffset >= bytes;
+      header[0] = fileHeader.width;
+      header[1] = fileHeader.height;
+      header[2] = fileHeader.maxColor;
+      header[3] = (long long)fileHeader.dataOffset;
+      header[4] = parallelRead;
+      if (!parallelRead) {
+        image = Image::create(magic, fileHeader.maxColor);
+        if (image->load(file)) {
+          parseThroughput = image->getParseThroughput();
+        } else {
+          std::cout << "Error, incorrect path or incorrect file." << std::endl;
+          header[0] = -1;
+        }
+      }
     }
+    if (file) fclose(file);
+  }
 
-    FILE *file = fopen(argv[1], "r");
-    if (file == NULL) {
-      std::cout << "Error, could not open the input file."<< std::endl;
+  MPI_Bcast(header, 5, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+  MPI_Bcast(magic, 3, MPI_CHAR, 0, MPI_COMM_WORLD);
+  if (header[0] < 0) {
+    delete image;
+    if (tracePath != NULL) traceClear();
+    MPI_Finalize();
+    return 1;
+  }
+
+  int width = (int)header[0];
+  int height = (int)header[1];
+  int maxColor = (int)header[2];
+  MPI_Offset dataOffset = (MPI_Offset)header[3];
+  bool parallelRead = header[4] != 0;
+
+  // Con --shared los ranks de cada host forman un nodo; los rank 0 de los
+  // nodos (el rank 0 global es el del primero) se reparten las bandas.
+  Band band;
+  if (node.shared) {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node.comm);
+  } else {
+    MPI_Comm_dup(MPI_COMM_SELF, &node.comm);
+  }
+  MPI_Comm_rank(node.comm, &node.rank);
+  MPI_Comm_size(node.comm, &node.size);
+  if (node.shared) {
+    MPI_Comm_split(MPI_COMM_WORLD, node.rank == 0 ? 0 : MPI_UNDEFINED, rank, &band.comm);
+  } else {
+    band.comm = MPI_COMM_WORLD;
+  }
+  // posicion del nodo entre los que pasan mensajes y cuantos son
+  int part[2] = {0, 1};
+  if (band.comm != MPI_COMM_NULL) {
+    MPI_Comm_rank(band.comm, &part[0]);
+    MPI_Comm_size(band.comm, &part[1]);
+  }
+  MPI_Bcast(part, 2, MPI_INT, 0, node.comm);
+  int parts = part[1];
+
+  // cada banda necesita al menos `halo` filas para que el halo venga solo
+  // del vecino inmediato; con imagenes pequenas sobran bandas
+  int active = std::max(1, std::min(parts, halo > 0 ? height / halo : height));
+
+  Image* probe = Image::create(magic, maxColor);
+  band.rowBytes = width * probe->getChannels() * probe->getSampleSize();
+  delete probe;
+  band.rowType = mpiRowType(band.rowBytes);
+
+  std::vector<int> counts(parts), displs(parts);
+  for (int r = 0; r < parts; r++) {
+    int startY, endY;
+    splitRows(r, active, height, &startY, &endY);
+    counts[r] = endY - startY;
+    displs[r] = startY;
+  }
+
+  int startY, endY;
+  splitRows(part[0], active, height, &startY, &endY);
+  band.rows = endY - startY;
+  band.up = part[0] > 0 && part[0] < active ? part[0] - 1 : MPI_PROC_NULL;
+  band.down = part[0] + 1 < active ? part[0] + 1 : MPI_PROC_NULL;
+  band.haloTop = band.up != MPI_PROC_NULL ? halo : 0;
+  int haloBottom = band.down != MPI_PROC_NULL ? halo : 0;
+  int localRows = band.haloTop + band.rows + haloBottom;
+
+  // banda local: halo superior, filas propias, halo inferior
+  Image* local = bandImage(magic, width, localRows, maxColor, band, node);
+
+  // con MPI-IO cada banda se lee con su halo y la primera etapa no lo intercambia
+  if (parallelRead) {
+    bool read = band.comm == MPI_COMM_NULL || readRows(argv[1], dataOffset, local, band, startY - band.haloTop, localRows);
+    if (!allRanks(read)) {
+      if (rank == 0) std::cout << "Error, could not read the input file with MPI-IO." << std::endl;
+      releaseBand(band, node, local, std::vector<Image*>());
       delete image;
+      if (tracePath != NULL) traceClear();
       MPI_Finalize();
       return 1;
     }
+  } else if (band.comm != MPI_COMM_NULL) {
+    TraceSpan span("scatter");
+    mpiScatterRows(image, counts.data(), displs.data(), band.rowType, bandRow(local, band, band.haloTop), band.comm);
+  }
+  nodeSync(node);
+  phases[PHASE_READ] = MPI_Wtime() - phaseStart;
 
-    image->load(file);
-    fclose(file);
-
-    int width = image->getWidth();
-    int height = image->getHeight();
-    int maxColor = image->getMaxColor();
-    const char* magic = image->getMagicNumber();
-
-    for (int i = 1; i < 4; i++) {
-        MPI_Send(&width, 1, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
-        MPI_Send(&height, 1, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
-        MPI_Send(&maxColor, 1, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
-        
-        int magic_len = strlen(magic) + 1;
-        MPI_Send(&magic_len, 1, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
-        MPI_Send(magic, magic_len, MPI_CHAR, i, TAG_WORK, MPI_COMM_WORLD);
+  // dos buffers que se turnan en la cadena; sin cadena, una salida por filtro
+  int resultCount = chain ? 2 : filterCount;
+  std::vector<Image*> localResults(resultCount);
+  for (int i = 0; i < resultCount; i++) {
+    localResults[i] = i == 0 && chain ? local : bandImage(magic, width, localRows, maxColor, band, node);
+  }
+  std::vector<Stage> stages;
+  if (chain) {
+    for (int k = 0; k < filterCount; k++) {
+      stages.push_back(Stage{&filters[k], 1, localResults[k % 2], &localResults[(k + 1) % 2], filterRadius(filters[k])});
     }
+  } else {
+    stages.push_back(Stage{filters, filterCount, local, localResults.data(), halo});
+  }
 
-    if (strcmp(magic, "P2") == 0) {
-        PGMImage* pgm = dynamic_cast<PGMImage*>(image);
-        int* pixels = pgm->getPixels();
-        int pixelCount = width * height;
-        
-        for (int i = 1; i < 4; i++) {
-            MPI_Send(pixels, pixelCount, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
-        }
-    } else if (strcmp(magic, "P3") == 0) {
-        PPMImage* ppm = dynamic_cast<PPMImage*>(image);
-        int* pixels = ppm->getPixels();
-        int pixelCount = width * height * 3;
-        
-        for (int i = 1; i < 4; i++) {
-            MPI_Send(pixels, pixelCount, MPI_INT, i, TAG_WORK, MPI_COMM_WORLD);
-        }
+  // El halo de la etapa k viaja mientras se calculan filas que no lo
+  // necesitan: el interior de la banda en la primera etapa y, despues, el
+  // interior de la etapa anterior. Los bordes se calculan antes que el
+  // interior para poder enviar cuanto antes el halo de la siguiente etapa.
+  // Con --blocking se espera justo despues de cada envio, para comparar.
+  // Con --shared todos los ranks del nodo calculan y solo su rank 0 envia.
+  ThreadPool pool(threads);
+  MPI_Request requests[4] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+  bool working = band.rows > 0;
+  double posted = 0.0;
+  for (int k = 0; working && k < (int)stages.size(); k++) {
+    const Stage& stage = stages[k];
+    bool more = k + 1 < (int)stages.size();
+    int next = more ? stages[k + 1].halo : 0;
+    int edge = std::min(band.rows, std::max(stage.halo, next));
+    int first = band.haloTop;
+    int last = band.haloTop + band.rows;
+    int topEnd = first + (band.up != MPI_PROC_NULL ? edge : 0);
+    int bottomStart = std::max(topEnd, last - (band.down != MPI_PROC_NULL ? edge : 0));
+
+    double t = MPI_Wtime();
+    if (k == 0) {
+      if (!parallelRead) postHalo(stage.src, band, stage.halo, k, requests);
+      posted = MPI_Wtime();
+      if (!blocking) filterRows(stage, node, pool, topEnd, bottomStart);
     }
+    double waitStart = MPI_Wtime();
+    {
+      TraceSpan span("halo wait");
+      MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+      nodeSync(node);
+    }
+    double waitEnd = MPI_Wtime();
+    phases[PHASE_HALO] += waitEnd - waitStart;
+    if (!blocking) phases[PHASE_OVERLAP] += waitStart - posted;
+    phases[PHASE_FILTER] += waitStart - t;
 
-    Image* results[3];
-    for (int i = 1; i < 4; i++) {
-        MPI_Status status;
-        int result_size;
-        MPI_Recv(&result_size, 1, MPI_INT, i, TAG_RESULT, MPI_COMM_WORLD, &status);
-        
-        int* result_pixels = new int[result_size];
-        MPI_Recv(result_pixels, result_size, MPI_INT, i, TAG_RESULT, MPI_COMM_WORLD, &status);
- 
-        if (strcmp(magic, "P2") == 0) {
-            PGMImage* result_img = new PGMImage();
-            result_img->loadFromData(magic, width, height, maxColor, result_pixels);
-            results[i-1] = result_img;
-        } else {
-            PPMImage* result_img = new PPMImage();
-            result_img->loadFromData(magic, width, height, maxColor, result_pixels);
-            results[i-1] = result_img;
-        }
-        
-        delete[] result_pixels;
+    filterRows(stage, node, pool, first, topEnd);
+    filterRows(stage, node, pool, bottomStart, last);
+    // los bordes tienen que estar completos antes de enviarlos
+    if (more) nodeSync(node);
+    double computed = MPI_Wtime();
+    phases[PHASE_FILTER] += computed - waitEnd;
+
+    if (more) {
+      postHalo(stages[k + 1].src, band, next, k + 1, requests);
+      posted = MPI_Wtime();
+      if (blocking) {
+        TraceSpan span("halo wait");
+        MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+        phases[PHASE_HALO] += MPI_Wtime() - posted;
+      }
+    }
+    if (k > 0 || blocking) {
+      double interiorStart = MPI_Wtime();
+      filterRows(stage, node, pool, topEnd, bottomStart);
+      phases[PHASE_FILTER] += MPI_Wtime() - interiorStart;
     }
+  }
+  nodeSync(node);
 
-    const char* output_files[] = {argv[2], argv[3], argv[4]};
-    for (int i = 0; i < 3; i++) {
-        FILE* output = fopen(output_files[i], "w");
-        if (output) {
-            results[i]->save(output);
-            fclose(output);
-        }
-        delete results[i];
+  phaseStart = MPI_Wtime();
+  Image* finalResult = chain ? localResults[filterCount % 2] : NULL;
+  bool saved = true;
+  if (isBinaryMagic(magic)) {
+    // la misma cabecera que escribe save()
+    char headerText[64];
+    snprintf(headerText, sizeof(headerText), "%s\n%d %d\n%d\n", magic, width, height, maxColor);
+    for (int i = 0; i < outputCount; i++) {
+      Image* source = chain ? finalResult : localResults[i];
+      bool written = band.comm == MPI_COMM_NULL || writeRows(outputPaths[i], headerText, source, band, startY, height);
+      if (!allRanks(written)) {
+        if (rank == 0) std::cout << "Error, could not create the output file " << outputPaths[i] << std::endl;
+        saved = false;
+      }
+    }
+  } else if (band.comm != MPI_COMM_NULL) {
+    for (int i = 0; i < outputCount; i++) {
+      Image* result = NULL;
+      if (rank == 0) {
+        result = Image::create(magic, maxColor);
+        result->allocate(magic, width, height, maxColor);
+      }
+      Image* source = chain ? finalResult : localResults[i];
+      TraceSpan span("gather");
+      mpiGatherRows(bandRow(source, band, band.haloTop), result, counts.data(), displs.data(), band.rowType, band.comm);
+      if (rank == 0) {
+        if (!saveImageFile(result, outputPaths[i])) saved = false;
+        delete result;
+      }
     }
-    
+  }
+  phases[PHASE_WRITE] = MPI_Wtime() - phaseStart;
+
+  double slowest[PHASE_COUNT];
+  MPI_Reduce(phases, slowest, PHASE_COUNT, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  std::vector<double> perRank(rank == 0 ? size * PHASE_COUNT : 0);
+  MPI_Gather(phases, PHASE_COUNT, MPI_DOUBLE, perRank.data(), PHASE_COUNT, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+  releaseBand(band, node, local, localResults);
+
+  if (rank == 0) {
     delete image;
-    
+
     double end_time = MPI_Wtime();
 
     double cpu_time = double(clock() - cpu_start) / CLOCKS_PER_SEC;
     auto wall_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> wall_time = wall_end - wall_start;
 
+    std::cout << "Ranks: " << size << " x " << pool.getThreads() << " threads, " << active << " bands" << std::endl;
+    if (node.shared) std::cout << "Nodes: " << parts << " (shared memory inside each node)" << std::endl;
+    for (int p = 0; p <= PHASE_WRITE; p++) {
+      std::cout << PHASE_NAMES[p] << " Time (max over ranks): " << slowest[p] << " seconds" << std::endl;
+    }
     std::cout << "MPI Total Time: " << end_time - start_time << " seconds" << std::endl;
     std::cout << "CPU Time (applying the filter only): " << cpu_time << " seconds" << std::endl;
     std::cout << "Total Execution Time: " << wall_time.count() << " seconds" << std::endl;
-  
-
-  }
-  else{
-    int width, height, maxColor, magic_len;
-    MPI_Status status;
-    
-    MPI_Recv(&width, 1, MPI_INT, 0, TAG_WORK, MPI_COMM_WORLD, &status);
-    MPI_Recv(&height, 1, MPI_INT, 0, TAG_WORK, MPI_COMM_WORLD, &status);
-    MPI_Recv(&maxColor, 1, MPI_INT, 0, TAG_WORK, MPI_COMM_WORLD, &status);
-    MPI_Recv(&magic_len, 1, MPI_INT, 0, TAG_WORK, MPI_COMM_WORLD, &status);
-    
-    char* magic = new char[magic_len];
-    MPI_Recv(magic, magic_len, MPI_CHAR, 0, TAG_WORK, MPI_COMM_WORLD, &status);
-    
-    int pixelCount;
-    if (strcmp(magic, "P2") == 0) {
-        pixelCount = width * height;
-    } else {
-        pixelCount = width * height * 3;
+    if (parseThroughput > 0) {
+      std::cout << "Parse throughput: " << parseThroughput << " MB/s" << std::endl;
     }
-    
-    int* pixels = new int[pixelCount];
-    MPI_Recv(pixels, pixelCount, MPI_INT, 0, TAG_WORK, MPI_COMM_WORLD, &status);
 
-    Image* image;
-    if (strcmp(magic, "P2") == 0) {
-        image = new PGMImage();
-    } else {
-        image = new PPMImage();
+    // Overlap: calculo hecho con el halo en vuelo. Wait: espera que no se
+    // pudo ocultar. Con --blocking todo el intercambio queda en Wait.
+    std::cout.flush();
+    printf("  Rank  Filter (s)  Halo wait (s)  Overlap (s)\n");
+    for (int r = 0; r < size; r++) {
+      const double* times = &perRank[r * PHASE_COUNT];
+      printf("%6d  %10.4f  %13.4f  %11.4f\n", r, times[PHASE_FILTER], times[PHASE_HALO], times[PHASE_OVERLAP]);
     }
-    
-    image->loadFromData(magic, width, height, maxColor, pixels);
-    
-    if (rank == 1) image->applyFilter("blur");
-    else if (rank == 2) image->applyFilter("laplace");
-    else if (rank == 3) image->applyFilter("sharpening");
-    
-    int* result_pixels;
-    if (strcmp(magic, "P2") == 0) {
-        result_pixels = dynamic_cast<PGMImage*>(image)->getPixels();
-    } else {
-        result_pixels = dynamic_cast<PPMImage*>(image)->getPixels();
+  }
+
+  if (tracePath != NULL) {
+    traceStop();
+    if (!traceWriteChrome(tracePath)) {
+      std::cout << "Error, could not write the trace " << tracePath << " on rank " << rank << std::endl;
+      saved = false;
+    } else if (rank == 0) {
+      fflush(stdout);
+      tracePrintSummary(stdout);
     }
-    
-    MPI_Send(&pixelCount, 1, MPI_INT, 0, TAG_RESULT, MPI_COMM_WORLD);
-    MPI_Send(result_pixels, pixelCount, MPI_INT, 0, TAG_RESULT, MPI_COMM_WORLD);
-    
-    delete[] magic;
-    delete[] pixels;
-    delete image;
+    traceClear();
   }
 
   MPI_Finalize();
 
-  return 0;
-}
\ No newline at end of file
+  return saved ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+#!/bin/bash
+# Escalado fuerte de mpi_filterer: misma imagen, de 1 a 64 ranks.
+# Uso: ./mpi_scaling.sh [imagen] [ranks...]   (desde la raiz del repositorio)
+# MPIRUN permite pasar opciones extra, p.ej. MPIRUN="mpirun --oversubscribe"
+
+IMAGE=${1:-images/damma.pgm}
+shift
+RANKS=${@:-1 2 4 8 16 32 64}
+MPIRUN=${MPIRUN:-mpirun}
+BIN=${BIN:-./mpi_filterer}
+EXT=${IMAGE##*.}
+OUT=$(mktemp -d)
+
+printf "%6s %10s %10s %10s %10s %10s %8s %8s\n" ranks read halo filter write total speedup effic
+base=""
+for np in $RANKS; do
+  log=$($MPIRUN -np $np $BIN "$IMAGE" $OUT/blur.$EXT $OUT/laplace.$EXT $OUT/sharpen.$EXT) || exit 1
+  field() { echo "$log" | grep "^$1" | awk '{print $(NF-1)}'; }
+  total=$(field "MPI Total Time")
+  [ -z "$base" ] && base=$total
+  printf "%6d %10.4f %10.4f %10.4f %10.4f %10.4f %8.2f %8.2f\n" $np \
+    $(field "Read") $(field "Halo") $(field "Filter") $(field "Write") $total \
+    $(awk "BEGIN {print $base / $total}") $(awk "BEGIN {print $base / $total / $np}")
+done
+
+rm -rf $OUT
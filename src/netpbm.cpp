@@ -0,0 +1,501 @@
+#include "netpbm.h"
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <algorithm>
+#include <limits>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define READ_CHUNK 65536
+#define MIN_PARSE_CHUNK (1 << 20)
+#define MAX_PARSE_THREADS 64
+#define MIN_FORMAT_SAMPLES (1 << 18)
+#define MAX_SAMPLE_TEXT 6
+
+MappedFile::MappedFile() : data(nullptr), size(0), mapped(false) {}
+MappedFile::~MappedFile() { unmap(); }
+
+bool MappedFile::map(FILE* file) {
+    unmap();
+
+    int fd = fileno(file);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // privado y escribible: las paginas solo se copian si alguien las modifica
+        void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            data = static_cast<unsigned char*>(addr);
+            size = st.st_size;
+            mapped = true;
+            return true;
+        }
+    }
+
+    // no se puede mapear (pipe, stdin...): leer todo a memoria
+    fseek(file, 0, SEEK_SET);
+    size_t capacity = READ_CHUNK;
+    unsigned char* buffer = static_cast<unsigned char*>(malloc(capacity));
+    size_t length = 0;
+    size_t n;
+    if (!buffer) return false;
+    while ((n = fread(buffer + length, 1, capacity - length, file)) > 0) {
+        length += n;
+        if (length == capacity) {
+            capacity *= 2;
+            unsigned char* grown = static_cast<unsigned char*>(realloc(buffer, capacity));
+            if (!grown) {
+                free(buffer);
+                return false;
+            }
+            buffer = grown;
+        }
+    }
+
+    data = buffer;
+    size = length;
+    mapped = false;
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (data) {
+        if (mapped) munmap(data, size);
+        else free(data);
+    }
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+static size_t skipSpaceAndComments(const unsigned char* data, size_t size, size_t pos) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n' && data[pos] != '\r') pos++;
+        } else if (isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    return pos;
+}
+
+static bool readHeaderInt(const unsigned char* data, size_t size, size_t* pos, int* value) {
+    size_t p = skipSpaceAndComments(data, size, *pos);
+    if (p >= size || !isdigit(data[p])) return false;
+
+    long result = 0;
+    while (p < size && isdigit(data[p])) {
+        result = result * 10 + (data[p] - '0');
+        if (result > 0x7fffffff) return false;
+        p++;
+    }
+    *value = static_cast<int>(result);
+    *pos = p;
+    return true;
+}
+
+bool parseNetpbmHeader(const unsigned char* data, size_t size, NetpbmHeader* header) {
+    if (size < 2 || data[0] != 'P') return false;
+    if (data[1] != '2' && data[1] != '3' && data[1] != '5' && data[1] != '6') return false;
+
+    header->magicNumber[0] = 'P';
+    header->magicNumber[1] = data[1];
+    header->magicNumber[2] = '\0';
+
+    size_t pos = 2;
+    if (!readHeaderInt(data, size, &pos, &header->width)) return false;
+    if (!readHeaderInt(data, size, &pos, &header->height)) return false;
+    if (!readHeaderInt(data, size, &pos, &header->maxColor)) return false;
+    if (header->width <= 0 || header->height <= 0) return false;
+    if (header->maxColor <= 0 || header->maxColor > 65535) return false;
+
+    // el raster binario empieza tras un unico caracter de espacio
+    if (pos >= size || !isspace(data[pos])) return false;
+    header->dataOffset = pos + 1;
+    return true;
+}
+
+// Igual que parseNetpbmHeader pero leyendo caracter a caracter, asi que sirve
+// para flujos que no se pueden mapear ni leer enteros a memoria.
+static int skipStreamSpace(FILE* input) {
+    int c = getc(input);
+    while (c != EOF && (isspace(c) || c == '#')) {
+        if (c == '#') {
+            while (c != EOF && c != '\n' && c != '\r') c = getc(input);
+        } else {
+            c = getc(input);
+        }
+    }
+    return c;
+}
+
+static bool readStreamInt(FILE* input, int* value, size_t* consumed) {
+    int c = skipStreamSpace(input);
+    if (c == EOF || !isdigit(c)) return false;
+
+    long result = 0;
+    while (c != EOF && isdigit(c)) {
+        result = result * 10 + (c - '0');
+        if (result > 0x7fffffff) return false;
+        c = getc(input);
+    }
+    *value = static_cast<int>(result);
+    // el caracter que corta el numero es el espacio que precede al raster
+    *consumed = (c != EOF && isspace(c)) ? 1 : 0;
+    return c != EOF;
+}
+
+bool readNetpbmHeader(FILE* input, NetpbmHeader* header) {
+    int p = getc(input);
+    int kind = getc(input);
+    if (p != 'P' || (kind != '2' && kind != '3' && kind != '5' && kind != '6')) return false;
+
+    header->magicNumber[0] = 'P';
+    header->magicNumber[1] = static_cast<char>(kind);
+    header->magicNumber[2] = '\0';
+
+    size_t space = 0;
+    if (!readStreamInt(input, &header->width, &space)) return false;
+    if (!readStreamInt(input, &header->height, &space)) return false;
+    if (!readStreamInt(input, &header->maxColor, &space) || space == 0) return false;
+    if (header->width <= 0 || header->height <= 0) return false;
+    if (header->maxColor <= 0 || header->maxColor > 65535) return false;
+
+    long offset = ftell(input);
+    header->dataOffset = offset > 0 ? (size_t)offset : 0;
+    return true;
+}
+
+bool isBinaryMagic(const char* magic) {
+    return strcmp(magic, "P5") == 0 || strcmp(magic, "P6") == 0;
+}
+
+int netpbmChannels(const char* magic) {
+    return (strcmp(magic, "P3") == 0 || strcmp(magic, "P6") == 0) ? 3 : 1;
+}
+
+int netpbmSampleBytes(int maxColor) {
+    return maxColor < 256 ? 1 : 2;
+}
+
+// recorre [p, end) y decodifica enteros; samples == nullptr solo cuenta
+template <typename Sample>
+static size_t scanAsciiChunk(const unsigned char* p, const unsigned char* end, Sample* samples, size_t limit) {
+    const int maxSample = std::numeric_limits<Sample>::max();
+    size_t n = 0;
+    while (p < end) {
+        unsigned c = *p;
+        if (c - '0' < 10) {
+            int value = c - '0';
+            p++;
+            while (p < end && (unsigned)(*p - '0') < 10) {
+                if (value <= maxSample) value = value * 10 + (*p - '0');
+                p++;
+            }
+            if (samples) {
+                if (n >= limit) break;
+                samples[n] = static_cast<Sample>(std::min(value, maxSample));
+            }
+            n++;
+        } else if (c == '#') {
+            while (p < end && *p != '\n' && *p != '\r') p++;
+        } else {
+            p++;
+        }
+    }
+    return n;
+}
+
+template <typename Sample>
+struct ParseChunk {
+    const unsigned char* begin;
+    const unsigned char* end;
+    Sample* samples;
+    size_t offset;
+    size_t limit;
+    size_t count;
+};
+
+template <typename Sample>
+static void* countChunkThread(void* arg) {
+    ParseChunk<Sample>* chunk = (ParseChunk<Sample>*)arg;
+    chunk->count = scanAsciiChunk<Sample>(chunk->begin, chunk->end, nullptr, 0);
+    return nullptr;
+}
+
+template <typename Sample>
+static void* decodeChunkThread(void* arg) {
+    ParseChunk<Sample>* chunk = (ParseChunk<Sample>*)arg;
+    size_t room = chunk->offset < chunk->limit ? chunk->limit - chunk->offset : 0;
+    scanAsciiChunk(chunk->begin, chunk->end, chunk->samples + chunk->offset, room);
+    return nullptr;
+}
+
+template <typename Chunk>
+static void runChunks(Chunk* chunks, int n, void* (*work)(void*)) {
+    pthread_t threads[MAX_PARSE_THREADS];
+    for (int i = 1; i < n; i++) pthread_create(&threads[i], nullptr, work, &chunks[i]);
+    work(&chunks[0]);
+    for (int i = 1; i < n; i++) pthread_join(threads[i], nullptr);
+}
+
+template <typename Sample>
+size_t parseAsciiSamples(const unsigned char* data, size_t size, Sample* samples, size_t count, int threads) {
+    int chunksWanted = (int)std::min<size_t>(size / MIN_PARSE_CHUNK + 1, threads);
+    chunksWanted = std::max(1, std::min(chunksWanted, MAX_PARSE_THREADS));
+
+    // los cortes caen justo despues de un '\n' para no partir numeros ni comentarios
+    ParseChunk<Sample> chunks[MAX_PARSE_THREADS];
+    const unsigned char* end = data + size;
+    const unsigned char* cursor = data;
+    int n = 0;
+    for (int i = 0; i < chunksWanted && cursor < end; i++) {
+        const unsigned char* cut = (i == chunksWanted - 1) ? end : data + size / chunksWanted * (i + 1);
+        if (cut < cursor) cut = cursor;
+        const unsigned char* nl = static_cast<const unsigned char*>(memchr(cut, '\n', end - cut));
+        cut = nl ? nl + 1 : end;
+        chunks[n++] = {cursor, cut, samples, 0, count, 0};
+        cursor = cut;
+    }
+
+    size_t total = 0;
+    if (n == 1) {
+        total = scanAsciiChunk(data, end, samples, count);
+    } else {
+        runChunks(chunks, n, countChunkThread<Sample>);
+        for (int i = 0; i < n; i++) {
+            chunks[i].offset = total;
+            total += chunks[i].count;
+        }
+        runChunks(chunks, n, decodeChunkThread<Sample>);
+    }
+
+    return std::min(total, count);
+}
+
+int netpbmThreads() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+template <typename Sample>
+void decodeBinarySamples(const unsigned char* data, Sample* samples, size_t count) {
+    if (sizeof(Sample) == 1) {
+        memcpy(samples, data, count);
+    } else {
+        for (size_t i = 0; i < count; i++) samples[i] = (data[2 * i] << 8) | data[2 * i + 1];
+    }
+}
+
+// las muestras de 16 bits se guardan en big-endian
+template <typename Sample>
+void encodeBinarySamples(const Sample* samples, unsigned char* data, size_t count) {
+    if (sizeof(Sample) == 1) {
+        memcpy(data, samples, count);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            data[2 * i] = static_cast<unsigned char>(samples[i] >> 8);
+            data[2 * i + 1] = static_cast<unsigned char>(samples[i] & 0xff);
+        }
+    }
+}
+
+// escribe todos los bloques con writev, reintentando si la escritura es
+// parcial o la interrumpe una senal
+static bool writeBlocks(FILE* output, struct iovec* blocks, int n) {
+    if (fflush(output) != 0) return false;
+    int fd = fileno(output);
+
+    while (n > 0) {
+        ssize_t written = writev(fd, blocks, n);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) return false;
+        while (n > 0 && (size_t)written >= blocks->iov_len) {
+            written -= blocks->iov_len;
+            blocks++;
+            n--;
+        }
+        if (n > 0) {
+            blocks->iov_base = static_cast<char*>(blocks->iov_base) + written;
+            blocks->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+struct SampleText {
+    char text[MAX_SAMPLE_TEXT + 1];
+    unsigned char length;
+};
+
+// tabla con el texto "v\n" de cada valor 0..maxColor
+static SampleText* createSampleTable(int maxColor) {
+    SampleText* table = new SampleText[maxColor + 1];
+    for (int v = 0; v <= maxColor; v++) {
+        table[v].length = snprintf(table[v].text, sizeof(table[v].text), "%d\n", v);
+    }
+    return table;
+}
+
+// Escribe en out el texto de count muestras y devuelve su longitud. out
+// necesita count * MAX_SAMPLE_TEXT + 1 bytes: el memcpy de la tabla copia
+// siempre el texto completo.
+template <typename Sample>
+static size_t formatSamples(const Sample* samples, size_t count, const SampleText* table, int maxColor, char* out) {
+    char* start = out;
+    for (size_t i = 0; i < count; i++) {
+        int value = samples[i];
+        if (value <= maxColor) {
+            memcpy(out, table[value].text, MAX_SAMPLE_TEXT + 1);
+            out += table[value].length;
+        } else {
+            out += snprintf(out, MAX_SAMPLE_TEXT + 1, "%d\n", value);
+        }
+    }
+    return out - start;
+}
+
+template <typename Sample>
+struct FormatChunk {
+    const Sample* samples;
+    size_t count;
+    const SampleText* table;
+    int maxColor;
+    char* buffer;
+    size_t length;
+};
+
+template <typename Sample>
+static void* formatChunkThread(void* arg) {
+    FormatChunk<Sample>* chunk = (FormatChunk<Sample>*)arg;
+    chunk->length = formatSamples(chunk->samples, chunk->count, chunk->table, chunk->maxColor, chunk->buffer);
+    return nullptr;
+}
+
+template <typename Sample>
+bool writeAsciiSamples(FILE* output, const Sample* samples, size_t count, int maxColor, size_t rowLength, int threads) {
+    SampleText* table = createSampleTable(maxColor);
+
+    size_t rows = rowLength > 0 ? (count + rowLength - 1) / rowLength : 1;
+    int n = (int)std::min<size_t>(count / MIN_FORMAT_SAMPLES + 1, threads);
+    n = std::max(1, std::min(n, std::min<int>(MAX_PARSE_THREADS, (int)rows)));
+
+    FormatChunk<Sample> chunks[MAX_PARSE_THREADS];
+    struct iovec blocks[MAX_PARSE_THREADS];
+    size_t row = 0;
+    for (int i = 0; i < n; i++) {
+        size_t nextRow = rows * (i + 1) / n;
+        size_t begin = std::min(count, row * rowLength);
+        size_t end = (i == n - 1) ? count : std::min(count, nextRow * rowLength);
+        chunks[i] = {samples + begin, end - begin, table, maxColor, new char[(end - begin) * MAX_SAMPLE_TEXT + 1], 0};
+        row = nextRow;
+    }
+
+    runChunks(chunks, n, formatChunkThread<Sample>);
+
+    for (int i = 0; i < n; i++) {
+        blocks[i].iov_base = chunks[i].buffer;
+        blocks[i].iov_len = chunks[i].length;
+    }
+    bool ok = writeBlocks(output, blocks, n);
+
+    for (int i = 0; i < n; i++) delete[] chunks[i].buffer;
+    delete[] table;
+    return ok;
+}
+
+template <typename Sample>
+bool writeBinarySamples(FILE* output, const Sample* samples, size_t count) {
+    struct iovec block;
+    unsigned char* swapped = nullptr;
+
+    if (sizeof(Sample) == 1) {
+        block.iov_base = const_cast<Sample*>(samples);
+        block.iov_len = count;
+    } else {
+        swapped = new unsigned char[count * 2];
+        encodeBinarySamples(samples, swapped, count);
+        block.iov_base = swapped;
+        block.iov_len = count * 2;
+    }
+
+    bool ok = writeBlocks(output, &block, 1);
+    delete[] swapped;
+    return ok;
+}
+
+AsciiSampleReader::AsciiSampleReader(FILE* file)
+    : input(file), buffer(new unsigned char[READ_CHUNK]), pos(0), length(0) {}
+
+AsciiSampleReader::~AsciiSampleReader() { delete[] buffer; }
+
+bool AsciiSampleReader::fill() {
+    if (pos < length) return true;
+    length = fread(buffer, 1, READ_CHUNK, input);
+    pos = 0;
+    return length > 0;
+}
+
+// los numeros y comentarios pueden quedar partidos entre dos bloques
+template <typename Sample>
+size_t AsciiSampleReader::read(Sample* samples, size_t count) {
+    const int maxSample = std::numeric_limits<Sample>::max();
+    size_t n = 0;
+    while (n < count && fill()) {
+        unsigned c = buffer[pos];
+        if (c - '0' < 10) {
+            int value = 0;
+            while (fill() && (unsigned)(buffer[pos] - '0') < 10) {
+                if (value <= maxSample) value = value * 10 + (buffer[pos] - '0');
+                pos++;
+            }
+            samples[n++] = static_cast<Sample>(std::min(value, maxSample));
+        } else if (c == '#') {
+            while (fill() && buffer[pos] != '\n' && buffer[pos] != '\r') pos++;
+        } else {
+            pos++;
+        }
+    }
+    return n;
+}
+
+AsciiSampleWriter::AsciiSampleWriter(int maxC)
+    : table(createSampleTable(maxC)), maxColor(maxC), buffer(nullptr), capacity(0) {}
+
+AsciiSampleWriter::~AsciiSampleWriter() {
+    delete[] buffer;
+    delete[] table;
+}
+
+template <typename Sample>
+bool AsciiSampleWriter::write(FILE* output, const Sample* samples, size_t count) {
+    if (count * MAX_SAMPLE_TEXT > capacity) {
+        delete[] buffer;
+        capacity = count * MAX_SAMPLE_TEXT;
+        buffer = new char[capacity + 1];
+    }
+    size_t length = formatSamples(samples, count, table, maxColor, buffer);
+    return fwrite(buffer, 1, length, output) == length;
+}
+
+template size_t AsciiSampleReader::read<uint8_t>(uint8_t*, size_t);
+template size_t AsciiSampleReader::read<uint16_t>(uint16_t*, size_t);
+template bool AsciiSampleWriter::write<uint8_t>(FILE*, const uint8_t*, size_t);
+template bool AsciiSampleWriter::write<uint16_t>(FILE*, const uint16_t*, size_t);
+template size_t parseAsciiSamples<uint8_t>(const unsigned char*, size_t, uint8_t*, size_t, int);
+template size_t parseAsciiSamples<uint16_t>(const unsigned char*, size_t, uint16_t*, size_t, int);
+template void decodeBinarySamples<uint8_t>(const unsigned char*, uint8_t*, size_t);
+template void decodeBinarySamples<uint16_t>(const unsigned char*, uint16_t*, size_t);
+template void encodeBinarySamples<uint8_t>(const uint8_t*, unsigned char*, size_t);
+template void encodeBinarySamples<uint16_t>(const uint16_t*, unsigned char*, size_t);
+template bool writeAsciiSamples<uint8_t>(FILE*, const uint8_t*, size_t, int, size_t, int);
+template bool writeAsciiSamples<uint16_t>(FILE*, const uint16_t*, size_t, int, size_t, int);
+template bool writeBinarySamples<uint8_t>(FILE*, const uint8_t*, size_t);
+template bool writeBinarySamples<uint16_t>(FILE*, const uint16_t*, size_t);
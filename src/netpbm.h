@@ -0,0 +1,98 @@
+#ifndef NETPBM_H
+#define NETPBM_H
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+struct NetpbmHeader {
+    char magicNumber[3];
+    int width;
+    int height;
+    int maxColor;
+    size_t dataOffset;
+};
+
+class MappedFile {
+private:
+    unsigned char* data;
+    size_t size;
+    bool mapped;
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool map(FILE* file);
+    void unmap();
+
+    const unsigned char* getData() const { return data; }
+    unsigned char* getMutableData() { return data; }
+    size_t getSize() const { return size; }
+};
+
+bool parseNetpbmHeader(const unsigned char* data, size_t size, NetpbmHeader* header);
+// lee la cabecera de un flujo y lo deja al principio del raster
+bool readNetpbmHeader(FILE* input, NetpbmHeader* header);
+bool isBinaryMagic(const char* magic);
+int netpbmChannels(const char* magic);
+int netpbmSampleBytes(int maxColor);
+
+template <typename Sample>
+size_t parseAsciiSamples(const unsigned char* data, size_t size, Sample* samples, size_t count, int threads);
+int netpbmThreads();
+
+template <typename Sample>
+void decodeBinarySamples(const unsigned char* data, Sample* samples, size_t count);
+template <typename Sample>
+void encodeBinarySamples(const Sample* samples, unsigned char* data, size_t count);
+template <typename Sample>
+bool writeAsciiSamples(FILE* output, const Sample* samples, size_t count, int maxColor, size_t rowLength, int threads);
+template <typename Sample>
+bool writeBinarySamples(FILE* output, const Sample* samples, size_t count);
+
+// Lee muestras de texto por bloques de un flujo, sin cargar el archivo
+// entero. Acepta lo mismo que parseAsciiSamples.
+class AsciiSampleReader {
+private:
+    FILE* input;
+    unsigned char* buffer;
+    size_t pos;
+    size_t length;
+
+    bool fill();
+
+public:
+    explicit AsciiSampleReader(FILE* input);
+    AsciiSampleReader(const AsciiSampleReader&) = delete;
+    AsciiSampleReader& operator=(const AsciiSampleReader&) = delete;
+    ~AsciiSampleReader();
+
+    // devuelve cuantas muestras leyo (menos de count si el flujo se acaba)
+    template <typename Sample>
+    size_t read(Sample* samples, size_t count);
+};
+
+struct SampleText;
+
+// Escribe muestras de texto, una por linea como writeAsciiSamples y con el
+// mismo formateador, en llamadas sucesivas; la tabla de textos se construye
+// una sola vez.
+class AsciiSampleWriter {
+private:
+    SampleText* table;
+    int maxColor;
+    char* buffer;
+    size_t capacity;
+
+public:
+    explicit AsciiSampleWriter(int maxColor);
+    AsciiSampleWriter(const AsciiSampleWriter&) = delete;
+    AsciiSampleWriter& operator=(const AsciiSampleWriter&) = delete;
+    ~AsciiSampleWriter();
+
+    template <typename Sample>
+    bool write(FILE* output, const Sample* samples, size_t count);
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include "netpbmimage.h"
+#include "filters.h"
+#include "tiled.h"
+#include "planar.h"
+#include "trace.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+
+// Los buffers de pixeles empiezan en una linea de cache, asi que los hilos
+// que escriben bandas de filas alineadas nunca comparten una linea.
+template <typename Sample>
+static Sample* allocateSamples(size_t count) {
+    size_t bytes = (count * sizeof(Sample) + PIXEL_ALIGNMENT - 1) / PIXEL_ALIGNMENT * PIXEL_ALIGNMENT;
+    return static_cast<Sample*>(aligned_alloc(PIXEL_ALIGNMENT, bytes > 0 ? bytes : PIXEL_ALIGNMENT));
+}
+
+template <typename Sample, int Channels>
+NetpbmImage<Sample, Channels>::NetpbmImage() : pixels(nullptr), ownsPixels(true) {
+    magicNumber[0] = '\0';
+    width = 0;
+    height = 0;
+    maxColor = 0;
+}
+
+template <typename Sample, int Channels>
+NetpbmImage<Sample, Channels>::~NetpbmImage() { releasePixels(); }
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::releasePixels() {
+    if (ownsPixels) free(pixels);
+    mapping.unmap();
+    pixels = nullptr;
+    ownsPixels = true;
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::replacePixels(Sample* newPixels) {
+    releasePixels();
+    pixels = newPixels;
+}
+
+template <typename Sample, int Channels>
+bool NetpbmImage<Sample, Channels>::load(FILE* input) {
+    TraceSpan span("load");
+    releasePixels();
+    width = 0;
+    height = 0;
+    parseThroughput = 0.0;
+
+    NetpbmHeader header;
+    if (!mapping.map(input) || !parseNetpbmHeader(mapping.getData(), mapping.getSize(), &header) ||
+        netpbmChannels(header.magicNumber) != Channels || netpbmSampleBytes(header.maxColor) != (int)sizeof(Sample)) {
+        mapping.unmap();
+        return false;
+    }
+
+    strcpy(magicNumber, header.magicNumber);
+    width = header.width;
+    height = header.height;
+    maxColor = header.maxColor;
+
+    size_t sampleCount = getSampleCount();
+    const unsigned char* body = mapping.getData() + header.dataOffset;
+    size_t bodySize = mapping.getSize() - header.dataOffset;
+
+    if (isBinaryMagic(magicNumber)) {
+        // un raster binario truncado no se puede usar: faltan filas enteras
+        if (sampleCount * sizeof(Sample) > bodySize) {
+            width = 0;
+            height = 0;
+            mapping.unmap();
+            return false;
+        }
+        if (sizeof(Sample) == 1) {
+            // P5/P6 de 8 bits: los pixeles son directamente las paginas mapeadas
+            pixels = reinterpret_cast<Sample*>(mapping.getMutableData() + header.dataOffset);
+            ownsPixels = false;
+            return true;
+        }
+        pixels = allocateSamples<Sample>(sampleCount);
+        decodeBinarySamples(body, pixels, sampleCount);
+        mapping.unmap();
+        return true;
+    }
+
+    pixels = allocateSamples<Sample>(sampleCount);
+    auto parseStart = std::chrono::steady_clock::now();
+    size_t parsed = parseAsciiSamples(body, bodySize, pixels, sampleCount, netpbmThreads());
+    std::chrono::duration<double> parseTime = std::chrono::steady_clock::now() - parseStart;
+    if (parseTime.count() > 0) parseThroughput = bodySize / 1e6 / parseTime.count();
+    if (parsed < sampleCount) {
+        memset(pixels + parsed, 0, (sampleCount - parsed) * sizeof(Sample));
+    }
+    mapping.unmap();
+    return true;
+}
+
+template <typename Sample, int Channels>
+bool NetpbmImage<Sample, Channels>::save(FILE* output) {
+    TraceSpan span("save");
+    if (fprintf(output, "%s\n%d %d\n%d\n", magicNumber, width, height, maxColor) < 0) return false;
+
+    size_t sampleCount = getSampleCount();
+    if (isBinaryMagic(magicNumber)) {
+        return writeBinarySamples(output, pixels, sampleCount);
+    }
+
+    return writeAsciiSamples(output, pixels, sampleCount, maxColor, (size_t)width * Channels, netpbmThreads());
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::detachInput() {
+    if (ownsPixels || mapping.getData() == nullptr) return;
+    Sample* copy = allocateSamples<Sample>(getSampleCount());
+    memcpy(copy, pixels, getDataSize());
+    replacePixels(copy);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::loadFromData(const char* magic, int w, int h, int maxC, const void* pix) {
+    strcpy(magicNumber, magic);
+    width = w;
+    height = h;
+    maxColor = maxC;
+
+    size_t sampleCount = getSampleCount();
+    Sample* copy = allocateSamples<Sample>(sampleCount);
+    memcpy(copy, pix, sampleCount * sizeof(Sample));
+    replacePixels(copy);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::allocate(const char* magic, int w, int h, int maxC) {
+    strcpy(magicNumber, magic);
+    width = w;
+    height = h;
+    maxColor = maxC;
+    replacePixels(allocateSamples<Sample>(getSampleCount()));
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::attach(const char* magic, int w, int h, int maxC, void* external) {
+    releasePixels();
+    strcpy(magicNumber, magic);
+    width = w;
+    height = h;
+    maxColor = maxC;
+    pixels = static_cast<Sample*>(external);
+    ownsPixels = false;
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::applyFilter(const Filter& filter) {
+    Sample* newPixels = allocateSamples<Sample>(getSampleCount());
+    applyFilterRegion(filter, pixels, newPixels, width * Channels, width, height, Channels, maxColor, false,
+                      0, height, 0, width);
+    replacePixels(newPixels);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::applyFilterChain(const Filter* filters, int count, bool pipelined) {
+    // pixels es uno de los dos buffers: la etapa 1 ya puede sobrescribir la entrada
+    Sample* spare = allocateSamples<Sample>(getSampleCount());
+    Sample* result = ::applyFilterChain(filters, count, pixels, spare, width, height, Channels, maxColor, pipelined);
+    if (result == spare) replacePixels(spare);
+    else free(spare);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::applyFilterChainTiled(const Filter* filters, int count) {
+    // las teselas solo viven durante el filtrado: load y save siguen por filas
+    TileLayout layout = makeTileLayout(width, height, Channels);
+    Sample* tiles = allocateSamples<Sample>(layout.sampleCount());
+    Sample* spare = allocateSamples<Sample>(layout.sampleCount());
+    rowsToTiles(pixels, tiles, layout);
+    Sample* result = ::applyFilterChainTiled(filters, count, tiles, spare, layout, maxColor);
+
+    TraceSpan span("writeback");
+    Sample* rows = allocateSamples<Sample>(getSampleCount());
+    tilesToRows(result, rows, layout);
+    free(tiles);
+    free(spare);
+    replacePixels(rows);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::applyFilterChainPlanar(const Filter* filters, int count, bool parallel) {
+    if (Channels == 1) {
+        // una imagen gris ya es un solo plano
+        applyFilterChain(filters, count, false);
+        return;
+    }
+
+    size_t sampleCount = getSampleCount();
+    Sample* planes = allocateSamples<Sample>(sampleCount);
+    Sample* spare = allocateSamples<Sample>(sampleCount);
+    splitPlanes(pixels, planes, (size_t)width * height, Channels);
+    Sample* result = applyFilterChainPlanes(filters, count, planes, spare, width, height, Channels, maxColor, parallel);
+
+    // el buffer que no tiene el resultado sirve de destino de la mezcla
+    Sample* rows = result == planes ? spare : planes;
+    TraceSpan span("writeback");
+    mergePlanes(result, rows, (size_t)width * height, Channels);
+    free(result);
+    replacePixels(rows);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::applyFilterToRegion(const Filter& filter, Image* output, int startY, int endY,
+                                                        int startX, int endX) {
+    startY = std::max(0, startY);
+    endY = std::min(height, endY);
+    startX = std::max(0, startX);
+    endX = std::min(width, endX);
+    if (startY >= endY || startX >= endX) return;
+
+    size_t rowLength = (size_t)width * Channels;
+    Sample* dst = static_cast<Sample*>(output->getRawPixels()) + startY * rowLength + startX * Channels;
+    applyFilterRegion(filter, pixels, dst, (int)rowLength, width, height, Channels, maxColor, false,
+                      startY, endY, startX, endX);
+}
+
+template <typename Sample, int Channels>
+void NetpbmImage<Sample, Channels>::applyFiltersToRegion(const Filter* filters, int count, Image* const* outputs,
+                                                         int startY, int endY) {
+    startY = std::max(0, startY);
+    endY = std::min(height, endY);
+    if (startY >= endY) return;
+
+    // se llama por cada bloque de filas: sin reservas en el heap
+    Sample* dsts[MAX_FILTER_CHAIN];
+    count = std::min(count, MAX_FILTER_CHAIN);
+    size_t rowLength = (size_t)width * Channels;
+    for (int i = 0; i < count; i++) {
+        dsts[i] = static_cast<Sample*>(outputs[i]->getRawPixels()) + startY * rowLength;
+    }
+    applyFiltersRegion(filters, count, pixels, dsts, (int)rowLength, width, height, Channels, maxColor, false,
+                       startY, endY);
+}
+
+template class NetpbmImage<uint8_t, 1>;
+template class NetpbmImage<uint16_t, 1>;
+template class NetpbmImage<uint8_t, 3>;
+template class NetpbmImage<uint16_t, 3>;
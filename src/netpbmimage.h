@@ -0,0 +1,53 @@
+#ifndef NETPBMIMAGE_H
+#define NETPBMIMAGE_H
+
+#include <cstdio>
+#include <cstdint>
+#include "image.h"
+#include "netpbm.h"
+
+#define PIXEL_ALIGNMENT 64
+
+// Imagen netpbm de Channels canales de Sample (uint8_t o uint16_t). Carga,
+// guardado y filtros son comunes a PGM y PPM y viven aqui; pgmimage.h y
+// ppmimage.h solo fijan el numero de canales.
+template <typename Sample, int Channels>
+class NetpbmImage : public Image {
+protected:
+    Sample* pixels;
+    bool ownsPixels;
+    MappedFile mapping;
+
+    void releasePixels();
+    void replacePixels(Sample* newPixels);
+
+public:
+    NetpbmImage();
+    NetpbmImage(const NetpbmImage&) = delete;
+    NetpbmImage& operator=(const NetpbmImage&) = delete;
+    ~NetpbmImage() override;
+
+    bool load(FILE* input) override;
+    bool save(FILE* output) override;
+    void detachInput() override;
+    void loadFromData(const char* magic, int width, int height, int maxColor, const void* pixels) override;
+    void allocate(const char* magic, int width, int height, int maxColor) override;
+    void attach(const char* magic, int width, int height, int maxColor, void* pixels) override;
+
+    using Image::applyFilter;
+    void applyFilter(const Filter& filter) override;
+    void applyFilterToRegion(const Filter& filter, Image* output, int startY, int endY, int startX, int endX) override;
+    void applyFiltersToRegion(const Filter* filters, int count, Image* const* outputs, int startY, int endY) override;
+    void applyFilterChain(const Filter* filters, int count, bool pipelined) override;
+    void applyFilterChainTiled(const Filter* filters, int count) override;
+    void applyFilterChainPlanar(const Filter* filters, int count, bool parallel) override;
+
+    int getChannels() const override { return Channels; }
+    int getSampleSize() const override { return sizeof(Sample); }
+    void* getRawPixels() override { return pixels; }
+
+    int getPixel(int index) const { return pixels[index]; }
+    Sample* getPixels() const { return pixels; }
+};
+
+#endif
@@ -1,107 +1,87 @@
 #include <iostream>
 #include <cstring>
-#include <ctime>
-#include <chrono>
+#include <cstdlib>
 #include <omp.h>
-#include "image.h"
-#include "pgmimage.h"
-#include "ppmimage.h"
+#include "backend.h"
+#include "batch.h"
+#include "cli.h"
 
 #define MAX_FILENAME 256
 #define BUFFER_SIZE 1024
 
+#define DEFAULT_CHUNK_ROWS 16
+
 int main(int argc, char* argv[]) {
 
-  if(argc<5){
+  // --backend: el mismo programa con cualquier estrategia de ejecucion
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--backend") == 0) return backendMain(argc, argv, NULL, NULL);
+  }
+
+  if(argc<3){
     std::cout << "Missing input and output paths\n";
     std::cout << "Usage:" << argv[0] << " input_image.pgm output_blur.pgm output_laplace.pgm output_sharpen.pgm" << std::endl;
-    std::cout << "or "<< argv[0] << "input_image.ppm output_blur.ppm output_laplace.ppm output_sharpen.ppm" << std::endl;
+    std::cout << "or "<< argv[0] << "input_image.ppm output1.ppm [output2.ppm ...] --f filter1[,filter2...] | --kernel file.k" << std::endl;
+    std::cout << "Options: --threads N --schedule static|dynamic|guided --chunk ROWS --trace trace.json" << std::endl;
+    std::cout << "or "<< argv[0] << " input_image output_image --f filters --backend " << availableBackends() << " [--threads N]" << std::endl;
+    std::cout << "or "<< argv[0] << " --batch manifest.txt | --batch directory --f filters --out directory [--threads N --schedule S --chunk ROWS]" << std::endl;
     return 1;
   }
 
-  auto wall_start = std::chrono::high_resolution_clock::now();
-
-  Image* image = Image::createFromFile(argv[1]);
-  if (image == NULL) {
-      std::cout << "Error, incorrect path or incorrect file." << std::endl;
-      return 1;
+  bool filterGiven = false;
+  int threads = 0;
+  omp_sched_t schedule = omp_sched_static;
+  int chunk = DEFAULT_CHUNK_ROWS;
+  for (int i = 2; i < argc; i++) {
+      if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+          threads = atoi(argv[++i]);
+          if (threads <= 0) {
+            std::cout << "Error, --threads must be a positive number" << std::endl;
+            return 1;
+          }
+      } else if (strcmp(argv[i], "--schedule") == 0 && i + 1 < argc) {
+          const char* kind = argv[++i];
+          if (strcmp(kind, "static") == 0) schedule = omp_sched_static;
+          else if (strcmp(kind, "dynamic") == 0) schedule = omp_sched_dynamic;
+          else if (strcmp(kind, "guided") == 0) schedule = omp_sched_guided;
+          else {
+            std::cout << "Error, wrong schedule. Use static, dynamic or guided" << std::endl;
+            return 1;
+          }
+      } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+          chunk = atoi(argv[++i]);
+          if (chunk <= 0) {
+            std::cout << "Error, --chunk must be a positive number" << std::endl;
+            return 1;
+          }
+      } else if (strcmp(argv[i], "--f") == 0 || strcmp(argv[i], "--kernel") == 0) {
+          filterGiven = true;
+      } else if (strcmp(argv[i], "--trace") == 0 && strcmp(argv[1], "--batch") == 0) {
+          std::cout << "Error, --trace can not be used with --batch" << std::endl;
+          return 1;
+      }
   }
-
-  FILE *file = fopen(argv[1], "r");
-  if (file == NULL) {
-    std::cout << "Error, could not open the input file."<< std::endl;
-    delete image;
-    return 1;
+  // Un solo barrido repartido por bloques de --chunk filas: cada iteracion
+  // calcula todos los filtros del bloque, asi el coste fijo de cada llamada
+  // (bordes, punteros de salida) se reparte entre chunk filas. El schedule
+  // reparte bloques con su tamano por defecto.
+  omp_set_schedule(schedule, 0);
+  Backend* backend = createOpenMPBackend(threads, chunk);
+  if (strcmp(argv[1], "--batch") == 0) {
+    // cada imagen del lote usa el mismo parallel for que una sola
+    std::cout << "Threads: " << backend->getWorkers() << std::endl;
+    int code = batchMain(argc, argv, backendBatchItem, backend);
+    delete backend;
+    return code;
   }
-
-  image->load(file);
-  fclose(file);
-
-  Image* blur = Image::createFromFile(argv[1]);
-  Image* laplace = Image::createFromFile(argv[1]);
-  Image* sharpen = Image::createFromFile(argv[1]);
-
-  FILE* file2 = fopen(argv[1], "r");
-  blur->load(file2);
-  fclose(file2);
-
-  FILE* file3 = fopen(argv[1], "r");
-  laplace->load(file3);
-  fclose(file3);
-
-  FILE* file4 = fopen(argv[1], "r");
-  sharpen->load(file4);
-  fclose(file4);
-
-  clock_t cpu_start = clock();
-  
-  #pragma omp parallel sections
-  {
-    #pragma omp section
-    {
-      blur->applyFilter("blur");
-    }
-    #pragma omp section
-    {
-      laplace->applyFilter("laplace");
-    }
-    #pragma omp section
-    {
-      sharpen->applyFilter("sharpening");
-    }
-  }
-  
-  clock_t cpu_end = clock();
-  double cpu_time = double(cpu_end - cpu_start) / CLOCKS_PER_SEC;
-
-  FILE* output1 = fopen(argv[2], "w");
-    if (output1) {
-        blur->save(output1);
-        fclose(output1);
-    }
-
-  FILE* output2 = fopen(argv[3], "w");
-  if (output2) {
-      laplace->save(output2);
-      fclose(output2);
-  }
-
-  FILE* output3 = fopen(argv[4], "w");
-  if (output3) {
-      sharpen->save(output3);
-      fclose(output3);
+  // sin --f, los tres filtros de siempre, uno por salida: con otro numero de
+  // salidas se encadenarian o no casarian
+  if (!filterGiven && countOutputPaths(argc, argv) != 3) {
+    std::cout << "Error, without --f or --kernel give three outputs (blur, laplace and sharpening)" << std::endl;
+    delete backend;
+    return 1;
   }
-
-  auto wall_end = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> wall_time = wall_end - wall_start;
-
-  delete image;
-  delete blur;
-  delete laplace;
-  delete sharpen;
-
-  std::cout << "CPU Time (applying the filter only): " << cpu_time << " seconds" << std::endl;
-  std::cout << "Total Execution Time: " << wall_time.count() << " seconds" << std::endl;
-  
-  return 0;
-}
\ No newline at end of file
+  int code = backendMain(argc, argv, backend, "blur,laplace,sharpening");
+  delete backend;
+  return code;
+}
@@ -1,27 +1,11 @@
 #ifndef PGMIMAGE_H
 #define PGMIMAGE_H
 
-#include <pthread.h>
-#include <cstdio>
-#include "image.h"
+#include <cstdint>
+#include "netpbmimage.h"
 
-class PGMImage : public Image {
-private:
-    int* pixels;  
-    void applyKernel(const float kernel[3][3]);
-    
-public:
-    PGMImage();
-    ~PGMImage() override;
-    
-    void load(FILE* input) override;
-    void save(FILE* output) override;
-    void applyFilter(const char* filterType) override;
-    void applyKernelToRegion(const float kernel[3][3], int startY, int endY, int startX, int endX, pthread_mutex_t* mutex);
-    void loadFromData(const char* magic, int width, int height, int maxColor, int* pixels) override;
-    
-    int getPixel(int index) const { return pixels[index]; }
-    int* getPixels() const { return pixels; }
-};
+// PGM: un canal de grises, de 8 o 16 bits
+template <typename Sample>
+using PGMImage = NetpbmImage<Sample, 1>;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,90 @@
+#include "planar.h"
+#include <algorithm>
+#include <pthread.h>
+
+template <typename Sample>
+void splitPlanes(const Sample* interleaved, Sample* planes, size_t pixelCount, int channels) {
+    if (channels == 3) {
+        // el caso RGB con el paso fijo, que el compilador sabe desentrelazar
+        Sample* r = planes;
+        Sample* g = planes + pixelCount;
+        Sample* b = planes + 2 * pixelCount;
+        for (size_t i = 0; i < pixelCount; i++) {
+            r[i] = interleaved[3 * i];
+            g[i] = interleaved[3 * i + 1];
+            b[i] = interleaved[3 * i + 2];
+        }
+        return;
+    }
+    for (int c = 0; c < channels; c++) {
+        for (size_t i = 0; i < pixelCount; i++) planes[c * pixelCount + i] = interleaved[i * channels + c];
+    }
+}
+
+template <typename Sample>
+void mergePlanes(const Sample* planes, Sample* interleaved, size_t pixelCount, int channels) {
+    if (channels == 3) {
+        const Sample* r = planes;
+        const Sample* g = planes + pixelCount;
+        const Sample* b = planes + 2 * pixelCount;
+        for (size_t i = 0; i < pixelCount; i++) {
+            interleaved[3 * i] = r[i];
+            interleaved[3 * i + 1] = g[i];
+            interleaved[3 * i + 2] = b[i];
+        }
+        return;
+    }
+    for (int c = 0; c < channels; c++) {
+        for (size_t i = 0; i < pixelCount; i++) interleaved[i * channels + c] = planes[c * pixelCount + i];
+    }
+}
+
+template <typename Sample>
+struct PlaneJob {
+    const Filter* filters;
+    int count;
+    Sample* plane;
+    Sample* spare;
+    int width;
+    int height;
+    int maxColor;
+    Sample* result;
+};
+
+template <typename Sample>
+static void* filterPlane(void* arg) {
+    PlaneJob<Sample>* job = static_cast<PlaneJob<Sample>*>(arg);
+    job->result = applyFilterChain(job->filters, job->count, job->plane, job->spare, job->width, job->height, 1,
+                                   job->maxColor, false);
+    return nullptr;
+}
+
+template <typename Sample>
+Sample* applyFilterChainPlanes(const Filter* filters, int count, Sample* planes, Sample* spare, int width, int height,
+                               int channels, int maxColor, bool parallel) {
+    size_t pixelCount = (size_t)width * height;
+    PlaneJob<Sample> jobs[4];
+    pthread_t threads[4];
+    bool started[4] = {false, false, false, false};
+    channels = std::min(channels, 4);
+
+    for (int c = 0; c < channels; c++) {
+        jobs[c] = {filters, count, planes + c * pixelCount, spare + c * pixelCount, width, height, maxColor, nullptr};
+        // el ultimo plano lo filtra el hilo que llama
+        if (parallel && c + 1 < channels) started[c] = pthread_create(&threads[c], nullptr, filterPlane<Sample>, &jobs[c]) == 0;
+        if (!started[c]) filterPlane<Sample>(&jobs[c]);
+    }
+    for (int c = 0; c < channels; c++) {
+        if (started[c]) pthread_join(threads[c], nullptr);
+    }
+    // todos los planos hacen las mismas etapas, asi que acaban en el mismo buffer
+    return jobs[0].result == jobs[0].plane ? planes : spare;
+}
+
+template void splitPlanes<uint8_t>(const uint8_t*, uint8_t*, size_t, int);
+template void splitPlanes<uint16_t>(const uint16_t*, uint16_t*, size_t, int);
+template void mergePlanes<uint8_t>(const uint8_t*, uint8_t*, size_t, int);
+template void mergePlanes<uint16_t>(const uint16_t*, uint16_t*, size_t, int);
+template uint8_t* applyFilterChainPlanes<uint8_t>(const Filter*, int, uint8_t*, uint8_t*, int, int, int, int, bool);
+template uint16_t* applyFilterChainPlanes<uint16_t>(const Filter*, int, uint16_t*, uint16_t*, int, int, int, int,
+                                                    bool);
@@ -0,0 +1,21 @@
+#ifndef PLANAR_H
+#define PLANAR_H
+
+#include <cstddef>
+#include "filters.h"
+
+// Disposicion planar: en vez de RGBRGB... cada canal ocupa un plano contiguo
+// de width x height muestras, planes[c * pixelCount + i].
+template <typename Sample>
+void splitPlanes(const Sample* interleaved, Sample* planes, size_t pixelCount, int channels);
+template <typename Sample>
+void mergePlanes(const Sample* planes, Sample* interleaved, size_t pixelCount, int channels);
+
+// Aplica la cadena a cada plano con la ruta de un canal (la misma que PGM).
+// planes y spare tienen channels planos; devuelve el que contiene el
+// resultado. Con parallel cada plano se filtra en su propio hilo.
+template <typename Sample>
+Sample* applyFilterChainPlanes(const Filter* filters, int count, Sample* planes, Sample* spare, int width, int height,
+                               int channels, int maxColor, bool parallel);
+
+#endif
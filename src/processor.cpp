@@ -12,11 +12,22 @@
 int main(int argc, char* argv[]) {
     if (argc < 3) {
         std::cout << "missing input and output paths\n";
-        std::cout << "usage:" << argv[0] << " input_image.pgm output_image.pgm" << std::endl;
-        std::cout << "or " << argv[0] << "input_image.ppm output_image.ppm" << std::endl;
+        std::cout << "usage:" << argv[0] << " input_image.pgm output_image.pgm [--binary|--ascii]" << std::endl;
+        std::cout << "or " << argv[0] << "input_image.ppm output_image.ppm [--binary|--ascii]" << std::endl;
         return 1;
     }
 
+    // --binary convierte a P5/P6, --ascii a P2/P3
+    int format = -1;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--binary") == 0) format = 1;
+        else if (strcmp(argv[i], "--ascii") == 0) format = 0;
+        else {
+            std::cout << "Error, unknown option " << argv[i] << ". Use --binary or --ascii" << std::endl;
+            return 1;
+        }
+    }
+
     Image* image = Image::createFromFile(argv[1]);
     if (image == NULL) {
         std::cout << "Error, incorrect path or incorrect file." << std::endl;
@@ -28,18 +39,30 @@ int main(int argc, char* argv[]) {
         delete image;
         return 1;
     }
-    image->load(file);
+    bool loaded = image->load(file);
     fclose(file);
+    if (!loaded) {
+        std::cout << "Error, incorrect path or incorrect file." << std::endl;
+        delete image;
+        return 1;
+    }
+
+    if (format >= 0) image->setBinary(format == 1);
 
+    // la salida puede ser la propia entrada
+    image->detachInput();
     FILE *output = fopen(argv[2], "w");
     if (output == NULL) {
         std::cout << "Error, could not open file." << std::endl;
         delete image;
         return 1;
     }
-    image->save(output);
-    fclose(output);
-    
+    bool saved = image->save(output);
+    if (fclose(output) != 0) saved = false;
     delete image;
+    if (!saved) {
+        std::cout << "Error, could not write file." << std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -2,149 +2,223 @@
 #include <cstring>
 #include <ctime>
 #include <chrono>
-#include <pthread.h>
+#include <algorithm>
+#include <cstdlib>
 #include "image.h"
 #include "pgmimage.h"
 #include "ppmimage.h"
+#include "netpbm.h"
+#include "filters.h"
+#include "threadpool.h"
+#include "workstealing.h"
+#include "batch.h"
+#include "backend.h"
+#include "cli.h"
+#include "trace.h"
 
 #define MAX_FILENAME 256
 #define BUFFER_SIZE 1024
 
-const float BLUR_KERNEL[3][3] = {{1.0/9, 1.0/9, 1.0/9}, {1.0/9, 1.0/9, 1.0/9}, {1.0/9, 1.0/9, 1.0/9}};
-const float LAPLACE_KERNEL[3][3] = {{0, 1, 0}, {1, -4, 1}, {0, 1, 0}};
-const float SHARPEN_KERNEL[3][3] = {{0, -1, 0}, {-1, 5, -1}, {0, -1, 0}};
+#define TILE_ROWS 64
+#define TILE_COLUMNS 256
 
-pthread_mutex_t pixelsMutex = PTHREAD_MUTEX_INITIALIZER;
-
-struct ThreadData {
+// Una tarea por tile y por filtro, todas en el mismo pool: los tiles de un
+// filtro caro se reparten entre los hilos que acaban antes.
+struct TileJob {
     Image* image;
-    const char* filterType;
-    int startY;
-    int endY;
-    int startX;
-    int endX;
-    pthread_mutex_t* mutex;
+    Image** outputs;
+    const Filter* filters;
+    int filterCount;
+    int tilesX;
 };
 
-void* applyFilterToRegion(void* arg) {
-    ThreadData* data = (ThreadData*)arg;
-    if (PGMImage* pgmImage = dynamic_cast<PGMImage*>(data->image)) {
-        if (strcmp(data->filterType, "blur") == 0) {
-            pgmImage->applyKernelToRegion(BLUR_KERNEL, data->startY, data->endY, 
-                                        data->startX, data->endX, data->mutex);
-        } else if (strcmp(data->filterType, "laplace") == 0) {
-            pgmImage->applyKernelToRegion(LAPLACE_KERNEL, data->startY, data->endY, 
-                                        data->startX, data->endX, data->mutex);
-        } else if (strcmp(data->filterType, "sharpening") == 0) {
-            pgmImage->applyKernelToRegion(SHARPEN_KERNEL, data->startY, data->endY, 
-                                        data->startX, data->endX, data->mutex);
-        }
-        
-    } else if (PPMImage* ppmImage = dynamic_cast<PPMImage*>(data->image)) {
-        if (strcmp(data->filterType, "blur") == 0) {
-            ppmImage->applyKernelToRegion(BLUR_KERNEL, data->startY, data->endY, 
-                                        data->startX, data->endX, data->mutex);
-        } else if (strcmp(data->filterType, "laplace") == 0) {
-            ppmImage->applyKernelToRegion(LAPLACE_KERNEL, data->startY, data->endY, 
-                                        data->startX, data->endX, data->mutex);
-        } else if (strcmp(data->filterType, "sharpening") == 0) {
-            ppmImage->applyKernelToRegion(SHARPEN_KERNEL, data->startY, data->endY, 
-                                        data->startX, data->endX, data->mutex);
-        }
-    }
-    
-    return nullptr;
+static void filterTile(void* context, int index) {
+    TileJob* job = (TileJob*)context;
+    TraceSpan span("filter tile");
+    int filter = index % job->filterCount;
+    int tile = index / job->filterCount;
+    int startY = tile / job->tilesX * TILE_ROWS;
+    int startX = tile % job->tilesX * TILE_COLUMNS;
+    job->image->applyFilterToRegion(job->filters[filter], job->outputs[filter],
+                                    startY, startY + TILE_ROWS, startX, startX + TILE_COLUMNS);
 }
 
 int main(int argc, char* argv[]) {
 
+  // --backend: el mismo programa con cualquier estrategia de ejecucion
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--backend") == 0) return backendMain(argc, argv, NULL, NULL);
+  }
+
+  if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+    // el lote siempre va por bandas o por cadena, una imagen tras otra
+    int threads = ThreadPool::hardwareThreads();
+    for (int i = 2; i < argc; i++) {
+      if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        threads = atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--steal") == 0 || strcmp(argv[i], "--planar") == 0 ||
+                 strcmp(argv[i], "--tiled") == 0 || strcmp(argv[i], "--trace") == 0) {
+        std::cout << "Error, " << argv[i] << " can not be used with --batch" << std::endl;
+        return 1;
+      }
+    }
+    Backend* backend = createBackend("pthreads", std::max(threads, 1));
+    std::cout << "Threads: " << backend->getWorkers() << std::endl;
+    int code = batchMain(argc, argv, backendBatchItem, backend);
+    delete backend;
+    return code;
+  }
+
   if(argc<4){
     std::cout << "Missing input and output paths\n";
-    std::cout << "Usage:" << argv[0] << " input_image.pgm output_image.pgm --f [blur|laplace|sharpening]" << std::endl;
-    std::cout << "or "<< argv[0] << "input_image.ppm output_image.ppm --f [blur|laplace|sharpening]" << std::endl;
+    std::cout << "Usage:" << argv[0] << " input_image.pgm output_image.pgm --f [blur|laplace|sharpening|gaussian5|gaussian7|sobelx|sobely|unsharp][,...]" << std::endl;
+    std::cout << "or "<< argv[0] << "input_image.ppm output_image.ppm --kernel file.k [--threads N] [--steal | --planar] [--trace trace.json]" << std::endl;
+    std::cout << "or "<< argv[0] << "input_image.pgm output_blur.pgm output_laplace.pgm --f blur,laplace [--threads N]" << std::endl;
+    std::cout << "or "<< argv[0] << " input_image output_image --f filters --backend " << availableBackends() << " [--threads N]" << std::endl;
+    std::cout << "or "<< argv[0] << " --batch manifest.txt | --batch directory --f filters --out directory [--threads N]" << std::endl;
     return 1;
   }
 
-  auto wall_start = std::chrono::high_resolution_clock::now();
+  // con una salida por filtro, cada filtro se aplica a la entrada por separado
+  int outputCount = countOutputPaths(argc, argv);
+  char** outputPaths = argv + 2;
 
   const char* filterType = nullptr;
-  for (int i = 3; i < argc; i++) {
+  const char* kernelFile = nullptr;
+  int threads = ThreadPool::hardwareThreads();
+  bool steal = false;
+  bool planar = false;
+  const char* tracePath = nullptr;
+  for (int i = 2 + outputCount; i < argc; i++) {
       if (strcmp(argv[i], "--f") == 0 && i + 1 < argc) {
-          filterType = argv[i + 1];
-          break;
+          filterType = argv[++i];
+      } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+          kernelFile = argv[++i];
+      } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+          threads = atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--steal") == 0) {
+          steal = true;
+      } else if (strcmp(argv[i], "--planar") == 0) {
+          planar = true;
+      } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+          tracePath = argv[++i];
       }
   }
-  if (filterType == NULL) {
-    std::cout << "Error, must specify a filter with --f" << std::endl;
+  if (threads <= 0) {
+    std::cout << "Error, --threads must be a positive number" << std::endl;
     return 1;
   }
-  if (strcmp(filterType, "blur") != 0 && 
-    strcmp(filterType, "laplace") != 0 && 
-    strcmp(filterType, "sharpening") != 0) {
-    std::cout << "Error, wrong filter. Use blur, laplace or sharpening" << std::endl;
+
+  Filter filters[MAX_FILTER_CHAIN];
+  int filterCount = parseFilterOptions(filterType, kernelFile, filters);
+  if (filterCount < 0) return 1;
+  if (outputCount == 0 || (outputCount > 1 && outputCount != filterCount)) {
+    std::cout << "Error, give one output path or one per filter" << std::endl;
     return 1;
   }
 
-  Image* image = Image::createFromFile(argv[1]);
-  if (image == NULL) {
-      std::cout << "Error, incorrect path or incorrect file." << std::endl;
-      return 1;
+  // Una salida con --planar va por planos y varias salidas (o --steal) por
+  // teselas con robo de trabajo. Lo demas es el programa comun con el
+  // backend pthreads: una cadena con un hilo por etapa o bandas de filas.
+  bool chain = outputCount == 1 && filterCount > 1;
+  if (steal && planar) {
+    std::cout << "Error, use either --steal or --planar" << std::endl;
+    return 1;
+  }
+  if (steal && chain) {
+    std::cout << "Error, --steal splits independent filters into tiles; give one output per filter instead of a chain" << std::endl;
+    return 1;
+  }
+  if (planar && outputCount > 1) {
+    std::cout << "Error, --planar needs a single output" << std::endl;
+    return 1;
   }
+  bool tiled = outputCount > 1 || steal;
+  if (!planar && !tiled) {
+    Backend* backend = createBackend("pthreads", threads);
+    int code = backendMain(argc, argv, backend, NULL);
+    delete backend;
+    return code;
+  }
+
+  auto wall_start = std::chrono::high_resolution_clock::now();
 
-  FILE *file = fopen(argv[1], "r");
-  if (file == NULL) {
-    std::cout << "Error, could not open the input file."<< std::endl;
+  if (tracePath != NULL) traceStart(0);
+
+  Image* image = loadImageFile(argv[1]);
+  if (image == NULL) {
+    if (tracePath != NULL) traceClear();
+    return 1;
+  }
+  if (planar && image->getChannels() == 1) {
+    std::cout << "Error, --planar needs a PPM image; a PGM has a single plane" << std::endl;
     delete image;
+    if (tracePath != NULL) traceClear();
     return 1;
   }
+  double parseThroughput = image->getParseThroughput();
 
-  image->load(file);
-  fclose(file);
-
-  clock_t cpu_start = clock();
+  ThreadPool pool(threads);
+  WorkStealingScheduler scheduler(pool);
 
   int width = image->getWidth();
   int height = image->getHeight();
-  int midX = width / 2;
-  int midY = height / 2;
-  ThreadData regions[4] = {
-      {image, filterType, 0, midY, 0, midX, &pixelsMutex},
-      {image, filterType, 0, midY, midX, width, &pixelsMutex},
-      {image, filterType, midY, height, 0, midX, &pixelsMutex},
-      {image, filterType, midY, height, midX, width, &pixelsMutex}
-    };
-    
-  pthread_t threads[4];
-    for (int i = 0; i < 4; i++) {
-        pthread_create(&threads[i], nullptr, applyFilterToRegion, &regions[i]);
-    }
-    
-    for (int i = 0; i < 4; i++) {
-        pthread_join(threads[i], nullptr);
+  Image* results[MAX_FILTER_CHAIN] = {image};
+
+  clock_t cpu_start = clock();
+
+  if (planar) {
+    // un plano por canal, cada uno en su hilo por la ruta de un canal
+    image->applyFilterChainPlanar(filters, filterCount, true);
+  } else if (height > 0) {
+    for (int i = 0; i < outputCount; i++) {
+      results[i] = Image::create(image->getMagicNumber(), image->getMaxColor());
+      results[i]->allocate(image->getMagicNumber(), width, height, image->getMaxColor());
     }
 
-  clock_t cpu_end = clock();
-  double cpu_time = double(cpu_end - cpu_start) / CLOCKS_PER_SEC;
+    int tilesX = (width + TILE_COLUMNS - 1) / TILE_COLUMNS;
+    int tilesY = (height + TILE_ROWS - 1) / TILE_ROWS;
+    TileJob job = {image, results, filters, outputCount, tilesX};
+    scheduler.run(tilesX * tilesY * outputCount, filterTile, &job);
 
-  FILE *output = fopen(argv[2], "w");
-  if (output == NULL) {
-    std::cout << "Error, could not create the output file."<< std::endl;
     delete image;
-    return 1;
+    image = NULL;
   }
 
-  image->save(output);
-  fclose(output);
+  clock_t cpu_end = clock();
+  double cpu_time = double(cpu_end - cpu_start) / CLOCKS_PER_SEC;
+
+  bool saved = true;
+  for (int i = 0; i < outputCount; i++) {
+    if (!saveImageFile(results[i], outputPaths[i])) saved = false;
+  }
 
   auto wall_end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> wall_time = wall_end - wall_start;
 
-  delete image;
+  for (int i = 0; i < outputCount; i++) delete results[i];
+  if (!saved) {
+    if (tracePath != NULL) traceClear();
+    return 1;
+  }
 
-  pthread_mutex_destroy(&pixelsMutex);
+  std::cout << "Threads: " << pool.getThreads() << std::endl;
+  printRunTimes(cpu_time, wall_time.count(), parseThroughput);
+  if (tiled) {
+    std::cout.flush();
+    scheduler.printStats(stdout);
+  }
+  if (tracePath != NULL) {
+    traceStop();
+    if (!traceWriteChrome(tracePath)) {
+      std::cout << "Error, could not write the trace " << tracePath << std::endl;
+      traceClear();
+      return 1;
+    }
+    std::cout.flush();
+    tracePrintSummary(stdout);
+    traceClear();
+  }
 
-  std::cout << "CPU Time (applying the filter only): " << cpu_time << " seconds" << std::endl;
-  std::cout << "Total Execution Time: " << wall_time.count() << " seconds" << std::endl;
-  
   return 0;
-}
\ No newline at end of file
+}
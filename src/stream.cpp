@@ -0,0 +1,179 @@
+#include "stream.h"
+#include "netpbm.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <sys/stat.h>
+
+// Escribe el raster por bandas de filas, en el formato de la entrada
+template <typename Sample>
+class StreamWriter {
+private:
+    FILE* output;
+    bool binary;
+    AsciiSampleWriter ascii;
+    std::vector<unsigned char> bytes;
+
+public:
+    bool ok;
+
+    StreamWriter(FILE* file, const NetpbmHeader& header)
+        : output(file), binary(isBinaryMagic(header.magicNumber)), ascii(binary ? 0 : header.maxColor), ok(true) {
+        ok = fprintf(output, "%s\n%d %d\n%d\n", header.magicNumber, header.width, header.height,
+                     header.maxColor) > 0;
+    }
+
+    void write(const Sample* samples, size_t count) {
+        if (!binary) {
+            ok = ascii.write(output, samples, count) && ok;
+            return;
+        }
+        bytes.resize(count * sizeof(Sample));
+        encodeBinarySamples(samples, bytes.data(), count);
+        ok = fwrite(bytes.data(), 1, bytes.size(), output) == bytes.size() && ok;
+    }
+};
+
+// Una etapa de la cadena. Recibe filas en orden con push y, cuando tiene las
+// filas de vecindario de la siguiente banda, la calcula y la pasa a la etapa
+// siguiente o al escritor. De la ventana se descartan las filas que ninguna
+// banda posterior va a leer.
+template <typename Sample>
+class StreamStage {
+private:
+    const Filter* filter;
+    int radius;
+    int width, height, channels, maxColor;
+    size_t rowSamples;
+    std::vector<Sample> window;
+    std::vector<Sample> band;
+    int windowStart;    // fila de la imagen que ocupa window[0]
+    int windowRows;
+    int nextRow;        // primera fila aun sin calcular
+    StreamStage* next;
+    StreamWriter<Sample>* writer;
+
+    void computeBand(int y1) {
+        int rows = y1 - nextRow;
+        Sample* dst = band.data();
+        // fuera de la ventana el motor rellena con ceros, que es justo lo que
+        // hace falta en los bordes de la imagen
+        applyFiltersRegion(filter, 1, window.data(), &dst, (int)rowSamples, width, windowRows, channels,
+                           maxColor, false, nextRow - windowStart, y1 - windowStart);
+        if (next) {
+            for (int r = 0; r < rows; r++) next->push(&band[r * rowSamples]);
+        } else {
+            writer->write(band.data(), rows * rowSamples);
+        }
+        nextRow = y1;
+
+        int drop = std::max(0, nextRow - radius - windowStart);
+        if (drop > 0) {
+            memmove(window.data(), &window[drop * rowSamples], (windowRows - drop) * rowSamples * sizeof(Sample));
+            windowStart += drop;
+            windowRows -= drop;
+        }
+    }
+
+public:
+    StreamStage(const Filter* f, const NetpbmHeader& header, StreamStage* nextStage, StreamWriter<Sample>* w)
+        : filter(f), radius(filterRadius(*f)), width(header.width), height(header.height),
+          channels(netpbmChannels(header.magicNumber)), maxColor(header.maxColor),
+          rowSamples((size_t)header.width * channels),
+          window((STREAM_BAND_ROWS + 2 * radius) * rowSamples), band(STREAM_BAND_ROWS * rowSamples),
+          windowStart(0), windowRows(0), nextRow(0), next(nextStage), writer(w) {}
+
+    size_t bufferBytes() const { return (window.size() + band.size()) * sizeof(Sample); }
+
+    void push(const Sample* row) {
+        memcpy(&window[windowRows * rowSamples], row, rowSamples * sizeof(Sample));
+        windowRows++;
+        while (nextRow < height) {
+            int y1 = std::min(nextRow + STREAM_BAND_ROWS, height);
+            if (windowStart + windowRows < std::min(y1 + radius, height)) break;
+            computeBand(y1);
+        }
+    }
+};
+
+// Lee el raster fila a fila; las muestras que falten quedan a cero y devuelve false
+template <typename Sample>
+static bool readRow(FILE* input, bool binary, AsciiSampleReader* ascii, std::vector<unsigned char>* bytes,
+                    Sample* row, size_t rowSamples) {
+    size_t got;
+    if (binary) {
+        size_t read = fread(bytes->data(), 1, rowSamples * sizeof(Sample), input);
+        got = read / sizeof(Sample);
+        decodeBinarySamples(bytes->data(), row, got);
+    } else {
+        got = ascii->read(row, rowSamples);
+    }
+    std::fill(row + got, row + rowSamples, 0);
+    return got == rowSamples;
+}
+
+template <typename Sample>
+static bool streamImage(FILE* input, FILE* output, const NetpbmHeader& header, const Filter* filters, int count,
+                        StreamStats* stats) {
+    bool binary = isBinaryMagic(header.magicNumber);
+    size_t rowSamples = (size_t)header.width * netpbmChannels(header.magicNumber);
+
+    // Un P5/P6 truncado es un error, como en load. Si la entrada es un archivo
+    // se sabe antes de escribir nada; en una tuberia, al llegar al final.
+    struct stat info;
+    if (binary && fstat(fileno(input), &info) == 0 && S_ISREG(info.st_mode) &&
+        (size_t)info.st_size < header.dataOffset + rowSamples * header.height * sizeof(Sample)) {
+        return false;
+    }
+
+    StreamWriter<Sample> writer(output, header);
+    std::vector<StreamStage<Sample>*> stages(count);
+    for (int i = count - 1; i >= 0; i--) {
+        stages[i] = new StreamStage<Sample>(&filters[i], header, i + 1 < count ? stages[i + 1] : NULL, &writer);
+    }
+
+    std::vector<Sample> row(rowSamples);
+    std::vector<unsigned char> bytes(binary ? rowSamples * sizeof(Sample) : 0);
+    AsciiSampleReader ascii(input);
+    // en texto las muestras que falten quedan a cero, como en load
+    bool complete = true;
+    for (int y = 0; y < header.height; y++) {
+        if (complete) complete = readRow(input, binary, &ascii, &bytes, row.data(), rowSamples);
+        else std::fill(row.begin(), row.end(), 0);
+        stages[0]->push(row.data());
+    }
+
+    stats->width = header.width;
+    stats->height = header.height;
+    stats->bufferBytes = row.size() * sizeof(Sample) + bytes.size();
+    for (StreamStage<Sample>* stage : stages) {
+        stats->bufferBytes += stage->bufferBytes();
+        delete stage;
+    }
+    return writer.ok && (complete || !binary);
+}
+
+bool streamFilterChain(const char* inputPath, const char* outputPath, const Filter* filters, int count,
+                       StreamStats* stats) {
+    FILE* input = fopen(inputPath, "rb");
+    if (input == NULL) return false;
+
+    NetpbmHeader header;
+    if (count <= 0 || !readNetpbmHeader(input, &header)) {
+        fclose(input);
+        return false;
+    }
+
+    FILE* output = fopen(outputPath, "wb");
+    if (output == NULL) {
+        fclose(input);
+        return false;
+    }
+
+    bool ok = netpbmSampleBytes(header.maxColor) == 2
+                  ? streamImage<uint16_t>(input, output, header, filters, count, stats)
+                  : streamImage<uint8_t>(input, output, header, filters, count, stats);
+    fclose(input);
+    return fclose(output) == 0 && ok;
+}
@@ -0,0 +1,25 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <cstddef>
+#include "filters.h"
+
+// filas que calcula cada etapa de una vez
+#define STREAM_BAND_ROWS 16
+
+struct StreamStats {
+    int width;
+    int height;
+    size_t bufferBytes;     // memoria de todas las ventanas y bandas
+};
+
+// Filtra input en output sin cargar la imagen: lee una fila cada vez, cada
+// filtro de la cadena guarda solo una ventana de STREAM_BAND_ROWS + 2 * radio
+// filas y las filas filtradas se escriben en cuanto estan listas. La memoria
+// es O(ancho x alto del kernel) para cualquier alto de imagen. Sirve para
+// P2, P3, P5 y P6 de 8 y 16 bits; el resultado es el mismo que con
+// applyFilterChain sobre la imagen entera.
+bool streamFilterChain(const char* inputPath, const char* outputPath, const Filter* filters, int count,
+                       StreamStats* stats);
+
+#endif
@@ -0,0 +1,112 @@
+#include "threadpool.h"
+#include <unistd.h>
+
+ThreadPool::ThreadPool(int threads)
+    : task(nullptr), context(nullptr), count(0), next(0), running(0), perThread(false), pending(0), generation(0),
+      stopping(false) {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&wake, nullptr);
+    pthread_cond_init(&finished, nullptr);
+
+    for (int i = 1; i < threads; i++) {
+        Worker* worker = new Worker{this, i, pthread_t()};
+        if (pthread_create(&worker->thread, nullptr, workerMain, worker) != 0) {
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&mutex);
+
+    for (Worker* worker : workers) {
+        pthread_join(worker->thread, nullptr);
+        delete worker;
+    }
+
+    pthread_cond_destroy(&finished);
+    pthread_cond_destroy(&wake);
+    pthread_mutex_destroy(&mutex);
+}
+
+int ThreadPool::hardwareThreads() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+// Reparte indices hasta que no quedan; se llama con el mutex tomado.
+void ThreadPool::drain() {
+    while (next < count) {
+        int index = next++;
+        running++;
+        pthread_mutex_unlock(&mutex);
+        task(context, index);
+        pthread_mutex_lock(&mutex);
+        running--;
+    }
+    if (running == 0) pthread_cond_broadcast(&finished);
+}
+
+void* ThreadPool::workerMain(void* arg) {
+    Worker* worker = static_cast<Worker*>(arg);
+    ThreadPool* pool = worker->pool;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (!pool->stopping && pool->generation == seen) pthread_cond_wait(&pool->wake, &pool->mutex);
+        if (pool->stopping) break;
+        seen = pool->generation;
+        if (!pool->perThread) {
+            pool->drain();
+            continue;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+        pool->task(pool->context, worker->index);
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->finished);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return nullptr;
+}
+
+void ThreadPool::run(int taskCount, Task newTask, void* newContext) {
+    if (taskCount <= 0) return;
+
+    pthread_mutex_lock(&mutex);
+    task = newTask;
+    context = newContext;
+    count = taskCount;
+    next = 0;
+    generation++;
+    pthread_cond_broadcast(&wake);
+
+    drain();
+    while (next < count || running > 0) pthread_cond_wait(&finished, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+void ThreadPool::runOnEachThread(Task newTask, void* newContext) {
+    pthread_mutex_lock(&mutex);
+    task = newTask;
+    context = newContext;
+    count = 0;
+    next = 0;
+    perThread = true;
+    pending = (int)workers.size();
+    generation++;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&mutex);
+
+    newTask(newContext, 0);
+
+    pthread_mutex_lock(&mutex);
+    while (pending > 0) pthread_cond_wait(&finished, &mutex);
+    perThread = false;
+    pthread_mutex_unlock(&mutex);
+}
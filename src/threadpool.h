@@ -0,0 +1,55 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <vector>
+
+// Hilos que se crean una vez y se reutilizan en cada run(). El hilo que
+// llama a run() tambien trabaja, asi que un pool de N usa N - 1 pthreads.
+class ThreadPool {
+public:
+    typedef void (*Task)(void* context, int index);
+
+    explicit ThreadPool(int threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // ejecuta task(context, i) para cada i en [0, count) y espera a que acaben
+    void run(int count, Task task, void* context);
+    // ejecuta task(context, t) una vez en cada hilo t del pool (0 es el que
+    // llama) y espera a que acaben: sirve para estado propio de cada hilo
+    void runOnEachThread(Task task, void* context);
+
+    int getThreads() const { return (int)workers.size() + 1; }
+
+    static int hardwareThreads();
+
+private:
+    struct Worker {
+        ThreadPool* pool;
+        int index;
+        pthread_t thread;
+    };
+
+    std::vector<Worker*> workers;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t finished;
+
+    Task task;
+    void* context;
+    int count;
+    int next;
+    int running;
+    // con runOnEachThread: cada hilo hace su indice y pending cuenta los que faltan
+    bool perThread;
+    int pending;
+    unsigned generation;
+    bool stopping;
+
+    static void* workerMain(void* arg);
+    void drain();
+};
+
+#endif
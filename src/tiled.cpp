@@ -0,0 +1,122 @@
+#include "tiled.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+TileLayout makeTileLayout(int width, int height, int channels) {
+    TileLayout layout;
+    layout.width = width;
+    layout.height = height;
+    layout.channels = channels;
+    layout.tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    layout.tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    layout.tileSamples = (size_t)TILE_SIZE * TILE_SIZE * channels;
+    return layout;
+}
+
+static inline size_t tileOffset(const TileLayout& layout, int tx, int ty) {
+    return ((size_t)ty * layout.tilesX + tx) * layout.tileSamples;
+}
+
+template <typename Sample>
+void rowsToTiles(const Sample* rows, Sample* tiles, const TileLayout& layout) {
+    size_t rowLength = (size_t)layout.width * layout.channels;
+    size_t tileRow = (size_t)TILE_SIZE * layout.channels;
+    for (int y = 0; y < layout.height; y++) {
+        for (int tx = 0; tx < layout.tilesX; tx++) {
+            int x0 = tx * TILE_SIZE;
+            size_t count = (size_t)(std::min(layout.width, x0 + TILE_SIZE) - x0) * layout.channels;
+            Sample* out = tiles + tileOffset(layout, tx, y / TILE_SIZE) + (y % TILE_SIZE) * tileRow;
+            memcpy(out, rows + y * rowLength + (size_t)x0 * layout.channels, count * sizeof(Sample));
+        }
+    }
+}
+
+template <typename Sample>
+void tilesToRows(const Sample* tiles, Sample* rows, const TileLayout& layout) {
+    size_t rowLength = (size_t)layout.width * layout.channels;
+    size_t tileRow = (size_t)TILE_SIZE * layout.channels;
+    for (int y = 0; y < layout.height; y++) {
+        for (int tx = 0; tx < layout.tilesX; tx++) {
+            int x0 = tx * TILE_SIZE;
+            size_t count = (size_t)(std::min(layout.width, x0 + TILE_SIZE) - x0) * layout.channels;
+            const Sample* in = tiles + tileOffset(layout, tx, y / TILE_SIZE) + (y % TILE_SIZE) * tileRow;
+            memcpy(rows + y * rowLength + (size_t)x0 * layout.channels, in, count * sizeof(Sample));
+        }
+    }
+}
+
+// Copia las columnas [x0, x1) de la fila y de la imagen por teselas; lo que
+// cae fuera de la imagen queda a cero.
+template <typename Sample>
+static void gatherSpan(const Sample* tiles, const TileLayout& layout, int y, int x0, int x1, Sample* out) {
+    int channels = layout.channels;
+    if (y < 0 || y >= layout.height) {
+        std::fill(out, out + (size_t)(x1 - x0) * channels, 0);
+        return;
+    }
+    size_t tileRow = (size_t)TILE_SIZE * channels;
+    int x = x0;
+    for (; x < std::min(x1, 0); x++, out += channels) std::fill(out, out + channels, 0);
+    while (x < std::min(x1, layout.width)) {
+        int tx = x / TILE_SIZE;
+        int end = std::min(std::min(x1, layout.width), (tx + 1) * TILE_SIZE);
+        const Sample* in = tiles + tileOffset(layout, tx, y / TILE_SIZE) + (y % TILE_SIZE) * tileRow +
+                           (size_t)(x - tx * TILE_SIZE) * channels;
+        memcpy(out, in, (size_t)(end - x) * channels * sizeof(Sample));
+        out += (size_t)(end - x) * channels;
+        x = end;
+    }
+    std::fill(out, out + (size_t)(x1 - x) * channels, 0);
+}
+
+template <typename Sample>
+void applyFilterTiles(const Filter& filter, const Sample* src, Sample* dst, const TileLayout& layout, int maxColor,
+                      int first, int last) {
+    int radius = filterRadius(filter);
+    int channels = layout.channels;
+    int side = TILE_SIZE + 2 * radius;
+    std::vector<Sample> scratch((size_t)side * side * channels);
+
+    for (int tile = first; tile < last; tile++) {
+        TraceSpan span("filter tile");
+        int tx = tile % layout.tilesX;
+        int ty = tile / layout.tilesX;
+        int x0 = tx * TILE_SIZE;
+        int y0 = ty * TILE_SIZE;
+        int tileWidth = std::min(TILE_SIZE, layout.width - x0);
+        int tileHeight = std::min(TILE_SIZE, layout.height - y0);
+
+        // la tesela con su halo es una imagen pequena de localWidth x localHeight
+        int localWidth = tileWidth + 2 * radius;
+        int localHeight = tileHeight + 2 * radius;
+        size_t localRow = (size_t)localWidth * channels;
+        for (int y = 0; y < localHeight; y++) {
+            gatherSpan(src, layout, y0 + y - radius, x0 - radius, x0 + tileWidth + radius, &scratch[y * localRow]);
+        }
+        applyFilterRegion(filter, scratch.data(), dst + tileOffset(layout, tx, ty), TILE_SIZE * channels,
+                          localWidth, localHeight, channels, maxColor, false,
+                          radius, radius + tileHeight, radius, radius + tileWidth);
+    }
+}
+
+template <typename Sample>
+Sample* applyFilterChainTiled(const Filter* filters, int count, Sample* tiles, Sample* spare,
+                              const TileLayout& layout, int maxColor) {
+    Sample* buffers[2] = {tiles, spare};
+    int tileCount = layout.tilesX * layout.tilesY;
+    for (int k = 0; k < count; k++) {
+        applyFilterTiles(filters[k], buffers[k % 2], buffers[(k + 1) % 2], layout, maxColor, 0, tileCount);
+    }
+    return buffers[count % 2];
+}
+
+template void rowsToTiles<uint8_t>(const uint8_t*, uint8_t*, const TileLayout&);
+template void rowsToTiles<uint16_t>(const uint16_t*, uint16_t*, const TileLayout&);
+template void tilesToRows<uint8_t>(const uint8_t*, uint8_t*, const TileLayout&);
+template void tilesToRows<uint16_t>(const uint16_t*, uint16_t*, const TileLayout&);
+template void applyFilterTiles<uint8_t>(const Filter&, const uint8_t*, uint8_t*, const TileLayout&, int, int, int);
+template void applyFilterTiles<uint16_t>(const Filter&, const uint16_t*, uint16_t*, const TileLayout&, int, int, int);
+template uint8_t* applyFilterChainTiled<uint8_t>(const Filter*, int, uint8_t*, uint8_t*, const TileLayout&, int);
+template uint16_t* applyFilterChainTiled<uint16_t>(const Filter*, int, uint16_t*, uint16_t*, const TileLayout&, int);
@@ -0,0 +1,46 @@
+#ifndef TILED_H
+#define TILED_H
+
+#include <cstddef>
+#include "filters.h"
+
+// lado de una tesela en pixeles
+#define TILE_SIZE 64
+
+// Disposicion por teselas: la imagen se parte en teselas de TILE_SIZE x
+// TILE_SIZE pixeles y cada una se guarda contigua, por filas de teselas. Las
+// teselas del borde derecho e inferior ocupan lo mismo aunque tengan menos
+// pixeles validos.
+struct TileLayout {
+    int width;
+    int height;
+    int channels;
+    int tilesX;
+    int tilesY;
+    size_t tileSamples;     // muestras de una tesela completa
+
+    size_t sampleCount() const { return tileSamples * tilesX * tilesY; }
+};
+
+TileLayout makeTileLayout(int width, int height, int channels);
+
+// conversion con la disposicion por filas, al cargar y al guardar
+template <typename Sample>
+void rowsToTiles(const Sample* rows, Sample* tiles, const TileLayout& layout);
+template <typename Sample>
+void tilesToRows(const Sample* tiles, Sample* rows, const TileLayout& layout);
+
+// Aplica el filtro a las teselas [first, last) de src. Cada tesela se copia con
+// un halo del radio del filtro a un buffer pequeno que cabe en cache y se
+// filtra ahi, asi que el vecindario de cada fila no se sale de L1/L2 por
+// ancha que sea la imagen. El resultado es el mismo que por filas.
+template <typename Sample>
+void applyFilterTiles(const Filter& filter, const Sample* src, Sample* dst, const TileLayout& layout, int maxColor,
+                      int first, int last);
+
+// filtros encadenados sobre dos buffers por teselas; devuelve el del resultado
+template <typename Sample>
+Sample* applyFilterChainTiled(const Filter* filters, int count, Sample* tiles, Sample* spare,
+                              const TileLayout& layout, int maxColor);
+
+#endif
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Compara filterer por filas y con --tiled (teselas de 64x64) en imagenes
+# anchas, donde tres filas de entrada ya no caben en L1/L2.
+# Uso: ./tiled_benchmark.sh [filtros] [anchos...]   (desde la raiz del repositorio)
+# Con perf instalado se muestran ademas los fallos de cache de cada ejecucion.
+# REPEATS repeticiones por configuracion; se muestra la mediana.
+
+FILTERS=${1:-gaussian7,laplace,blur}
+shift
+WIDTHS=${@:-2048 8192 16384 32768}
+HEIGHT=${HEIGHT:-1024}
+REPEATS=${REPEATS:-3}
+BIN=${BIN:-.}
+EVENTS=cache-references,cache-misses,L1-dcache-load-misses
+OUT=$(mktemp -d)
+
+# mediana del "CPU Time" (filtro y conversion de disposicion) de REPEATS ejecuciones
+median() {
+  for i in $(seq $REPEATS); do
+    "$@" | grep "^CPU Time" | awk '{print $(NF-1)}'
+  done | sort -g | awk '{t[NR] = $1} END {print t[int((NR + 1) / 2)]}'
+}
+
+# fallos de cache y de L1 (en millones) de una ejecucion, o "-" sin perf
+misses() {
+  if ! command -v perf > /dev/null; then echo "- -"; return; fi
+  perf stat -x, -e $EVENTS "$@" 2>&1 > /dev/null |
+    awk -F, '$3 == "cache-misses" {c = $1 / 1e6} $3 == "L1-dcache-load-misses" {l = $1 / 1e6}
+             END {printf "%.2f %.2f\n", c, l}'
+}
+
+printf "%8s %8s %10s %10s %12s %12s\n" width layout "time (s)" speedup "cache-miss M" "L1-miss M"
+for width in $WIDTHS; do
+  image=$OUT/wide.ppm
+  { printf "P6\n%d %d\n255\n" $width $HEIGHT; head -c $((width * HEIGHT * 3)) /dev/urandom; } > $image
+
+  rows=$(median $BIN/filterer $image $OUT/rows.ppm --f $FILTERS)
+  tiles=$(median $BIN/filterer $image $OUT/tiles.ppm --f $FILTERS --tiled)
+  cmp -s $OUT/rows.ppm $OUT/tiles.ppm || echo "Error, --tiled differs at width $width"
+  printf "%8d %8s %10.4f %10.2f %12s %12s\n" $width rows $rows 1 \
+    $(misses $BIN/filterer $image $OUT/rows.ppm --f $FILTERS)
+  printf "%8d %8s %10.4f %10.2f %12s %12s\n" $width tiles $tiles $(awk "BEGIN {print $rows / $tiles}") \
+    $(misses $BIN/filterer $image $OUT/tiles.ppm --f $FILTERS --tiled)
+done
+
+rm -rf $OUT
@@ -0,0 +1,293 @@
+#include "trace.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+std::atomic<bool> traceEnabled(false);
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+    uint64_t counters[TRACE_COUNTERS];
+    // el grupo no estuvo en la PMU todo el intervalo y los contadores se
+    // han escalado
+    bool scaled;
+};
+
+// Estado de un hilo: solo el propio hilo escribe en events, y se lee al
+// final, cuando ya no queda ningun span abierto.
+struct TraceThread {
+    int id;
+    // descriptor del lider del grupo de contadores (-1 sin contadores) y
+    // posicion de cada contador en la lectura del grupo (-1 si no se abrio)
+    int leader;
+    int slots[TRACE_COUNTERS];
+    int fds[TRACE_COUNTERS];
+    std::vector<TraceEvent> events;
+};
+
+static const char* counterNames[TRACE_COUNTERS] = {"cycles", "instructions", "cache_misses", "llc_misses"};
+
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<TraceThread*> registry;
+static thread_local TraceThread* currentThread = nullptr;
+// traceClear() libera los TraceThread; un hilo cuyo estado es de una
+// generacion anterior se vuelve a registrar
+static std::atomic<unsigned> generation(0);
+static thread_local unsigned currentGeneration = 0;
+static uint64_t origin = 0;
+static int processId = 0;
+// los hilos abren sus contadores a la vez, fuera de registryMutex
+static std::atomic<bool> countersOpened(false);
+static std::atomic<int> counterError(0);
+
+static uint64_t monotonicNanoseconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+// Abre los cuatro contadores del hilo que llama como un grupo, para leerlos
+// todos con un solo read(). Solo cuentan en modo usuario, asi funcionan con
+// perf_event_paranoid <= 2 sin privilegios.
+static void openCounters(TraceThread* thread) {
+    thread->leader = -1;
+    for (int i = 0; i < TRACE_COUNTERS; i++) {
+        thread->slots[i] = -1;
+        thread->fds[i] = -1;
+    }
+#ifdef __linux__
+    static const uint32_t types[TRACE_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                   PERF_TYPE_HW_CACHE};
+    static const uint64_t configs[TRACE_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+
+    int opened = 0;
+    for (int i = 0; i < TRACE_COUNTERS; i++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // con mas contadores que registros de la PMU el kernel reparte el
+        // tiempo entre grupos; los tiempos permiten escalar la cuenta
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, thread->leader, 0);
+        if (fd < 0) {
+            int expected = 0;
+            counterError.compare_exchange_strong(expected, errno);
+            continue;
+        }
+        if (thread->leader < 0) thread->leader = fd;
+        thread->fds[i] = fd;
+        thread->slots[i] = opened++;
+    }
+    if (opened > 0) countersOpened = true;
+#endif
+}
+
+// values recibe los contadores seguidos del tiempo habilitado y del tiempo
+// en la PMU del grupo
+static void readCounters(const TraceThread* thread, uint64_t* values) {
+    uint64_t group[3 + TRACE_COUNTERS] = {0};
+    if (thread->leader < 0 || read(thread->leader, group, sizeof(group)) <= 0) {
+        for (int i = 0; i < TRACE_READ_VALUES; i++) values[i] = 0;
+        return;
+    }
+    for (int i = 0; i < TRACE_COUNTERS; i++) {
+        values[i] = thread->slots[i] >= 0 ? group[3 + thread->slots[i]] : 0;
+    }
+    values[TRACE_COUNTERS] = group[1];
+    values[TRACE_COUNTERS + 1] = group[2];
+}
+
+static TraceThread* registerThread() {
+    TraceThread* thread = new TraceThread();
+    openCounters(thread);
+    pthread_mutex_lock(&registryMutex);
+    thread->id = (int)registry.size();
+    registry.push_back(thread);
+    pthread_mutex_unlock(&registryMutex);
+    currentGeneration = generation.load();
+    return thread;
+}
+
+static TraceThread* threadState() {
+    if (currentThread == nullptr || currentGeneration != generation.load()) currentThread = registerThread();
+    return currentThread;
+}
+
+void TraceSpan::begin(const char* spanName) {
+    threadState();
+    name = spanName;
+    readCounters(currentThread, counters);
+    start = monotonicNanoseconds();
+}
+
+void TraceSpan::end() {
+    uint64_t finish = monotonicNanoseconds();
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = finish - start;
+    uint64_t values[TRACE_READ_VALUES];
+    readCounters(currentThread, values);
+    uint64_t enabled = values[TRACE_COUNTERS] - counters[TRACE_COUNTERS];
+    uint64_t running = values[TRACE_COUNTERS + 1] - counters[TRACE_COUNTERS + 1];
+    // si el grupo solo conto parte del intervalo se extrapola al total
+    event.scaled = running > 0 && running < enabled;
+    for (int i = 0; i < TRACE_COUNTERS; i++) {
+        uint64_t delta = values[i] - counters[i];
+        event.counters[i] = event.scaled ? (uint64_t)((double)delta * enabled / running) : delta;
+    }
+    currentThread->events.push_back(event);
+}
+
+void traceStart(int process) {
+    processId = process;
+    origin = monotonicNanoseconds();
+    // el hilo que activa la traza es el 0 de la linea de tiempo
+    threadState();
+    traceEnabled.store(true);
+}
+
+void traceStop() {
+    traceEnabled.store(false);
+    pthread_mutex_lock(&registryMutex);
+    for (TraceThread* thread : registry) {
+        for (int i = 0; i < TRACE_COUNTERS; i++) {
+            if (thread->fds[i] >= 0) close(thread->fds[i]);
+            thread->fds[i] = -1;
+            thread->slots[i] = -1;
+        }
+        thread->leader = -1;
+    }
+    pthread_mutex_unlock(&registryMutex);
+}
+
+void traceClear() {
+    pthread_mutex_lock(&registryMutex);
+    for (TraceThread* thread : registry) {
+        for (int i = 0; i < TRACE_COUNTERS; i++) {
+            if (thread->fds[i] >= 0) close(thread->fds[i]);
+        }
+        delete thread;
+    }
+    registry.clear();
+    generation++;
+    pthread_mutex_unlock(&registryMutex);
+    currentThread = nullptr;
+}
+
+bool traceCountersAvailable() {
+    return countersOpened;
+}
+
+bool traceWriteChrome(const char* path) {
+    std::string processPath = path;
+    if (processId > 0) processPath += ".rank" + std::to_string(processId);
+    FILE* output = fopen(processPath.c_str(), "w");
+    if (output == NULL) return false;
+
+    fprintf(output, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(output, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"rank %d\"}}",
+            processId, processId);
+    pthread_mutex_lock(&registryMutex);
+    for (const TraceThread* thread : registry) {
+        fprintf(output, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, "
+                        "\"args\": {\"name\": \"%s %d\"}}",
+                processId, thread->id, thread->id == 0 ? "main" : "thread", thread->id);
+        for (const TraceEvent& event : thread->events) {
+            fprintf(output, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    event.name, processId, thread->id, (event.start - origin) / 1000.0, event.duration / 1000.0);
+            if (countersOpened) {
+                fprintf(output, ", \"args\": {");
+                for (int i = 0; i < TRACE_COUNTERS; i++) {
+                    fprintf(output, "%s\"%s\": %llu", i > 0 ? ", " : "", counterNames[i],
+                            (unsigned long long)event.counters[i]);
+                }
+                fprintf(output, "}");
+            }
+            fprintf(output, "}");
+        }
+    }
+    pthread_mutex_unlock(&registryMutex);
+    fprintf(output, "\n]}\n");
+    return fclose(output) == 0;
+}
+
+struct SpanSummary {
+    const char* name;
+    int count;
+    uint64_t total;
+    uint64_t longest;
+    uint64_t counters[TRACE_COUNTERS];
+    int scaled;
+    // tiempo de este span en cada hilo que lo ejecuto
+    std::map<int, uint64_t> perThread;
+};
+
+void tracePrintSummary(FILE* output) {
+    // en el orden en que aparece cada nombre; la misma cadena puede estar en
+    // varias unidades de compilacion, asi que se comparan con strcmp
+    std::vector<SpanSummary> spans;
+    pthread_mutex_lock(&registryMutex);
+    for (const TraceThread* thread : registry) {
+        for (const TraceEvent& event : thread->events) {
+            size_t s = 0;
+            while (s < spans.size() && strcmp(spans[s].name, event.name) != 0) s++;
+            if (s == spans.size()) spans.push_back(SpanSummary{event.name, 0, 0, 0, {0, 0, 0, 0}, 0, {}});
+            SpanSummary& span = spans[s];
+            span.count++;
+            span.total += event.duration;
+            if (event.duration > span.longest) span.longest = event.duration;
+            for (int i = 0; i < TRACE_COUNTERS; i++) span.counters[i] += event.counters[i];
+            if (event.scaled) span.scaled++;
+            span.perThread[thread->id] += event.duration;
+        }
+    }
+    int threads = (int)registry.size();
+    pthread_mutex_unlock(&registryMutex);
+
+    int scaledEvents = 0;
+    for (const SpanSummary& span : spans) scaledEvents += span.scaled;
+
+    fprintf(output, "Span           Count  Total (s)  Mean (ms)   Max (ms)  Threads  Imbalance    IPC  Cache misses    LLC misses\n");
+    for (const SpanSummary& span : spans) {
+        uint64_t busiest = 0;
+        for (const auto& entry : span.perThread) busiest = std::max(busiest, entry.second);
+        double meanPerThread = (double)span.total / span.perThread.size();
+        fprintf(output, "%-13s %6d  %9.4f  %9.3f  %9.3f  %7d  %9.2f", span.name, span.count, span.total * 1e-9,
+                span.total * 1e-6 / span.count, span.longest * 1e-6, (int)span.perThread.size(),
+                busiest / meanPerThread);
+        if (countersOpened && span.counters[0] > 0) {
+            fprintf(output, "  %5.2f  %12llu  %12llu\n", (double)span.counters[1] / span.counters[0],
+                    (unsigned long long)span.counters[2], (unsigned long long)span.counters[3]);
+        } else {
+            fprintf(output, "  %5s  %12s  %12s\n", "-", "-", "-");
+        }
+    }
+    if (!countersOpened) {
+        fprintf(output, "Hardware counters not available (perf_event_open: %s)\n",
+                counterError != 0 ? strerror(counterError) : "not supported");
+    }
+    if (scaledEvents > 0) {
+        fprintf(output, "Counters multiplexed in %d spans, scaled by time enabled / time running\n", scaledEvents);
+    }
+    fprintf(output, "Traced threads: %d\n", threads);
+}
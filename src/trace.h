@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+
+// Contadores de hardware de cada span: ciclos, instrucciones, fallos de
+// cache y fallos del ultimo nivel de cache (LLC)
+#define TRACE_COUNTERS 4
+// lectura de los contadores mas los tiempos habilitado y en la PMU del grupo
+#define TRACE_READ_VALUES (TRACE_COUNTERS + 2)
+
+// Instrumentacion opcional. Mientras traceEnabled sea false un TraceSpan
+// solo comprueba esa variable: no lee el reloj ni guarda nada. Los hilos la
+// leen sin orden (relaxed); los spans que empiecen mientras cambia se pueden
+// perder, pero nunca quedan a medias.
+extern std::atomic<bool> traceEnabled;
+
+// Intervalo con nombre en el hilo actual, desde el constructor hasta el
+// destructor. Cada hilo guarda sus spans en su propio buffer, sin locks; el
+// nombre debe ser una cadena literal (solo se guarda el puntero).
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* spanName) : name(nullptr) {
+        if (traceEnabled.load(std::memory_order_relaxed)) begin(spanName);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan() {
+        if (name) end();
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+    uint64_t counters[TRACE_READ_VALUES];
+
+    void begin(const char* spanName);
+    void end();
+};
+
+// Activa la traza; process identifica al proceso (el rank con MPI) en la
+// linea de tiempo. Los contadores se abren con perf_event_open en cada hilo
+// la primera vez que registra un span; si el sistema no los permite los
+// spans solo llevan tiempos.
+void traceStart(int process);
+void traceStop();
+// Libera el estado de todos los hilos; se llama despues de escribir la traza
+// y el resumen. Una traza posterior empieza vacia.
+void traceClear();
+bool traceCountersAvailable();
+
+// Linea de tiempo en el formato JSON de Chrome (chrome://tracing, Perfetto):
+// un evento por span, un hilo por fila. Se llama con los hilos ya parados.
+// El proceso 0 escribe en path y el proceso p > 0 en path.rankp, para que
+// cada rank de MPI deje su propia traza.
+bool traceWriteChrome(const char* path);
+// Por nombre de span: veces, tiempo total, medio y maximo, desequilibrio
+// entre hilos (maximo / media del tiempo por hilo) y contadores.
+void tracePrintSummary(FILE* output);
+
+#endif
@@ -0,0 +1,114 @@
+#include "workstealing.h"
+#include <cstdio>
+#include <ctime>
+
+static double monotonicSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+WorkStealingScheduler::WorkStealingScheduler(ThreadPool& threadPool)
+    : pool(threadPool), task(nullptr), context(nullptr) {
+    for (int i = 0; i < pool.getThreads(); i++) {
+        Queue* queue = new Queue();
+        pthread_mutex_init(&queue->mutex, nullptr);
+        queue->stats = WorkerStats{0.0, 0, 0};
+        queues.push_back(queue);
+    }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+    for (Queue* queue : queues) {
+        pthread_mutex_destroy(&queue->mutex);
+        delete queue;
+    }
+}
+
+bool WorkStealingScheduler::popLocal(int worker, int* index) {
+    Queue* queue = queues[worker];
+    pthread_mutex_lock(&queue->mutex);
+    bool found = !queue->indices.empty();
+    if (found) {
+        *index = queue->indices.back();
+        queue->indices.pop_back();
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return found;
+}
+
+// Recorre las demas colas empezando por una al azar y se lleva la tarea mas
+// antigua de la primera que tenga trabajo: es la mas lejana de lo que su
+// dueno esta procesando ahora.
+bool WorkStealingScheduler::steal(int worker, unsigned* seed, int* index) {
+    int workers = (int)queues.size();
+    *seed = *seed * 1103515245u + 12345u;
+    int start = (int)((*seed >> 16) % (unsigned)workers);
+
+    for (int i = 0; i < workers; i++) {
+        int victim = (start + i) % workers;
+        if (victim == worker) continue;
+
+        Queue* queue = queues[victim];
+        pthread_mutex_lock(&queue->mutex);
+        bool found = !queue->indices.empty();
+        if (found) {
+            *index = queue->indices.front();
+            queue->indices.pop_front();
+        }
+        pthread_mutex_unlock(&queue->mutex);
+        if (found) return true;
+    }
+    return false;
+}
+
+void WorkStealingScheduler::workerMain(void* arg, int worker) {
+    WorkStealingScheduler* scheduler = static_cast<WorkStealingScheduler*>(arg);
+    WorkerStats& stats = scheduler->queues[worker]->stats;
+    unsigned seed = 2654435761u * (worker + 1);
+
+    // ninguna tarea crea otras: si todas las colas estan vacias no queda trabajo
+    int index;
+    while (true) {
+        bool stolen = false;
+        if (!scheduler->popLocal(worker, &index)) {
+            if (!scheduler->steal(worker, &seed, &index)) break;
+            stolen = true;
+        }
+
+        double start = monotonicSeconds();
+        scheduler->task(scheduler->context, index);
+        stats.busySeconds += monotonicSeconds() - start;
+        stats.tasks++;
+        if (stolen) stats.steals++;
+    }
+}
+
+void WorkStealingScheduler::run(int count, Task newTask, void* newContext) {
+    if (count <= 0) return;
+
+    task = newTask;
+    context = newContext;
+    int workers = (int)queues.size();
+    for (int w = 0; w < workers; w++) {
+        Queue* queue = queues[w];
+        int first = (int)((long)count * w / workers);
+        int last = (int)((long)count * (w + 1) / workers);
+        pthread_mutex_lock(&queue->mutex);
+        for (int i = first; i < last; i++) queue->indices.push_back(i);
+        queue->stats = WorkerStats{0.0, 0, 0};
+        pthread_mutex_unlock(&queue->mutex);
+    }
+
+    // cada hilo del pool ejecuta su propio worker, asi que la cola y las
+    // estadisticas de w son las del hilo w
+    pool.runOnEachThread(workerMain, this);
+}
+
+void WorkStealingScheduler::printStats(FILE* output) const {
+    fprintf(output, "Worker  Busy (s)   Tasks  Steals\n");
+    for (int w = 0; w < (int)queues.size(); w++) {
+        const WorkerStats& stats = queues[w]->stats;
+        fprintf(output, "%6d  %8.4f  %6d  %6d\n", w, stats.busySeconds, stats.tasks, stats.steals);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef WORKSTEALING_H
+#define WORKSTEALING_H
+
+#include <pthread.h>
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include "threadpool.h"
+
+struct WorkerStats {
+    double busySeconds;
+    int tasks;
+    int steals;
+};
+
+// Reparto con robo de trabajo sobre los hilos de un ThreadPool: el worker w
+// es siempre el hilo w del pool. Cada worker empieza con un bloque contiguo
+// de indices en su cola: saca los suyos por detras y, cuando se queda sin
+// trabajo, roba por delante de las colas de los demas. Sirve para tareas de coste desigual (filtros distintos, tiles
+// con mas o menos trabajo, nucleos compartidos).
+class WorkStealingScheduler {
+public:
+    typedef ThreadPool::Task Task;
+
+    explicit WorkStealingScheduler(ThreadPool& pool);
+    WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+    WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+    ~WorkStealingScheduler();
+
+    // ejecuta task(context, i) para cada i en [0, count) y espera a que acaben
+    void run(int count, Task task, void* context);
+
+    int getWorkers() const { return (int)queues.size(); }
+    // estadisticas de la ultima llamada a run()
+    const WorkerStats& getStats(int worker) const { return queues[worker]->stats; }
+    void printStats(FILE* output) const;
+
+private:
+    struct Queue {
+        pthread_mutex_t mutex;
+        std::deque<int> indices;
+        WorkerStats stats;
+    };
+
+    ThreadPool& pool;
+    std::vector<Queue*> queues;
+    Task task;
+    void* context;
+
+    static void workerMain(void* arg, int worker);
+    bool popLocal(int worker, int* index);
+    bool steal(int worker, unsigned* seed, int* index);
+};
+
+#endif